@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+    FastMathBench.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef FAST_MATH_BENCH_H
+#define FAST_MATH_BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <JuceHeader.h>
+#include "../../Source/FastMath.h"
+
+/// Times every FastMath function and tier against the float libm function it replaces, over arrays
+/// the compiler can vectorise, and checks the largest error over the function's domain against the
+/// maximum documented in FastMath.h.
+class FastMathBench
+{
+public:
+    /// @return bool, true if every error is within its documented maximum
+    static bool run()
+    {
+        bool passed = true;
+
+        std::printf("%-28s %10s %10s %10s %10s %9s  %s\n", "function", "max error", "documented", "libm(ns)", "fast(ns)", "speedup", "result");
+
+        // sin2Pi: an oscillator phase, sin: radians
+        {
+            const auto phases = makeInputs(-32.0, 32.0);
+            const auto reference = [](double x) { return std::sin(juce::MathConstants<double>::twoPi * x); };
+            const auto libm = [](float x) { return std::sin(juce::MathConstants<float>::twoPi * x); };
+
+            passed &= print("sin2Pi draft", phases, false, 7.0e-5, reference, libm, [](float x) { return FastMath::sin2Pi<FastMath::draft>(x); });
+            passed &= print("sin2Pi normal", phases, false, 8.0e-7, reference, libm, [](float x) { return FastMath::sin2Pi<FastMath::normal>(x); });
+            passed &= print("sin2Pi precise", phases, false, 2.0e-7, reference, libm, [](float x) { return FastMath::sin2Pi<FastMath::precise>(x); });
+
+            const auto radians = makeInputs(-4.0 * juce::MathConstants<double>::pi, 4.0 * juce::MathConstants<double>::pi);
+            const auto sinReference = [](double x) { return std::sin(x); };
+            const auto sinLibm = [](float x) { return std::sin(x); };
+
+            passed &= print("sin draft", radians, false, 7.0e-5, sinReference, sinLibm, [](float x) { return FastMath::sin<FastMath::draft>(x); });
+            passed &= print("sin normal", radians, false, 2.0e-6, sinReference, sinLibm, [](float x) { return FastMath::sin<FastMath::normal>(x); });
+            passed &= print("sin precise", radians, false, 1.0e-6, sinReference, sinLibm, [](float x) { return FastMath::sin<FastMath::precise>(x); });
+        }
+
+        // tan: up to 0.49 of the sample rate, and up to a quarter of it
+        for (const double limit : { 0.49, 0.25 })
+        {
+            const auto inputs = makeInputs(-limit * juce::MathConstants<double>::pi, limit * juce::MathConstants<double>::pi);
+            const auto reference = [](double x) { return std::tan(x); };
+            const auto libm = [](float x) { return std::tan(x); };
+            const bool full = limit > 0.25;
+
+            passed &= print(full ? "tan draft" : "tan draft, <= pi/4", inputs, true, full ? 3.0e-4 : 3.0e-7, reference, libm, [](float x) { return FastMath::tan<FastMath::draft>(x); });
+            passed &= print(full ? "tan normal" : "tan normal, <= pi/4", inputs, true, full ? 3.0e-6 : 3.0e-7, reference, libm, [](float x) { return FastMath::tan<FastMath::normal>(x); });
+            passed &= print(full ? "tan precise" : "tan precise, <= pi/4", inputs, true, 1.0e-7, reference, libm, [](float x) { return FastMath::tan<FastMath::precise>(x); });
+        }
+
+        {
+            const auto inputs = makeInputs(-126.0, 127.99);
+            const auto reference = [](double x) { return std::exp2(x); };
+            const auto libm = [](float x) { return std::exp2(x); };
+
+            passed &= print("exp2 draft", inputs, true, 9.0e-5, reference, libm, [](float x) { return FastMath::exp2<FastMath::draft>(x); });
+            passed &= print("exp2 normal", inputs, true, 3.0e-6, reference, libm, [](float x) { return FastMath::exp2<FastMath::normal>(x); });
+            passed &= print("exp2 precise", inputs, true, 2.0e-7, reference, libm, [](float x) { return FastMath::exp2<FastMath::precise>(x); });
+        }
+
+        // pitch: against juce::MidiMessage::getMidiNoteInHertz()'s formula
+        {
+            const auto inputs = makeInputs(0.0, 127.0);
+            const auto reference = [](double x) { return 440.0 * std::pow(2.0, (x - 69.0) / 12.0); };
+            const auto libm = [](float x) { return 440.0f * std::exp2((x - 69.0f) * (1.0f / 12.0f)); };
+
+            passed &= print("pitchToFrequency draft", inputs, true, 9.0e-5, reference, libm, [](float x) { return FastMath::pitchToFrequency<FastMath::draft>(x); });
+            passed &= print("pitchToFrequency normal", inputs, true, 4.0e-6, reference, libm, [](float x) { return FastMath::pitchToFrequency<FastMath::normal>(x); });
+            passed &= print("pitchToFrequency precise", inputs, true, 5.0e-7, reference, libm, [](float x) { return FastMath::pitchToFrequency<FastMath::precise>(x); });
+
+            int numWrongNotes = 0;
+            for (int note = 0; note < 128; note++)
+                numWrongNotes += FastMath::pitchToFrequency<FastMath::draft>((float) note) != (float) juce::MidiMessage::getMidiNoteInHertz(note) ? 1 : 0;
+
+            std::printf("%-28s %d of 128 differ from juce::MidiMessage::getMidiNoteInHertz()  %s\n", "whole notes", numWrongNotes, numWrongNotes == 0 ? "ok" : "FAIL");
+            passed &= numWrongNotes == 0;
+        }
+
+        std::printf("\n%s\n", passed ? "all within the documented errors" : "FAILED");
+        return passed;
+    }
+
+private:
+    static constexpr int numErrorPoints = 1 << 20;   // spread over the domain for the error
+    static constexpr int numTimedValues = 4096;      // one array, fits in L1
+    static constexpr int numTimedPasses = 2000;
+
+    static std::vector<float> makeInputs(double _from, double _to)
+    {
+        std::vector<float> inputs((size_t) numErrorPoints);
+        for (int i = 0; i < numErrorPoints; i++)
+            inputs[(size_t) i] = (float) (_from + (_to - _from) * i / (numErrorPoints - 1));
+
+        return inputs;
+    }
+
+    /// seconds per value of a function over numTimedValues inputs from the middle of the domain
+    template <typename Function>
+    static double time(const std::vector<float>& _inputs, Function _function)
+    {
+        // two arrays the compiler can see do not overlap, so the loop vectorises without alias checks
+        static float in[numTimedValues], out[numTimedValues];
+        std::copy(_inputs.begin() + (std::ptrdiff_t) (_inputs.size() - numTimedValues) / 2,
+                  _inputs.begin() + (std::ptrdiff_t) (_inputs.size() + numTimedValues) / 2, in);
+        float sum = 0.0f;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < numTimedPasses; pass++)
+        {
+            for (int i = 0; i < numTimedValues; i++)
+                out[i] = _function(in[i]);
+
+            sum += out[pass % numTimedValues];
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // the outputs are used, the loops cannot be dropped
+        if (sum == 1.2345f)
+            std::printf(" ");
+
+        return seconds / ((double) numTimedPasses * numTimedValues);
+    }
+
+    template <typename Reference, typename Libm, typename Fast>
+    static bool print(const char* _name, const std::vector<float>& _inputs, bool _relative, double _documented,
+                      Reference _reference, Libm _libm, Fast _fast)
+    {
+        double maxError = 0.0;
+        for (const float x : _inputs)
+        {
+            const double expected = _reference((double) x);
+            const double error = std::abs((double) _fast(x) - expected) / (_relative ? std::abs(expected) : 1.0);
+            maxError = std::isfinite(error) ? juce::jmax(maxError, error) : maxError;
+        }
+
+        const double libmSeconds = time(_inputs, _libm);
+        const double fastSeconds = time(_inputs, _fast);
+        const bool ok = maxError <= _documented;
+
+        std::printf("%-28s %10.3g %10.3g %10.2f %10.2f %8.2fx  %s\n", _name, maxError, _documented, libmSeconds * 1.0e9, fastSeconds * 1.0e9,
+                    libmSeconds / fastSeconds, ok ? "ok" : "FAIL");
+        return ok;
+    }
+};
+
+#endif // FAST_MATH_BENCH_H
@@ -0,0 +1,482 @@
+/*
+  ==============================================================================
+
+    GoldenCompare.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef GOLDEN_COMPARE_H
+#define GOLDEN_COMPARE_H
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <vector>
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include "OfflineRender.h"
+#include "ReferenceSynth.h"
+
+/// Renders fixed MIDI and parameter scenarios through the frozen scalar reference (ReferenceSynth.h)
+/// and through the optimised processor, and compares the outputs: bit-exact where the optimised
+/// path promises it, otherwise within an error level relative to the reference.
+/// The single DSP kernels are compared the same way, each with its speedup over the reference.
+class GoldenCompare
+{
+public:
+    /// run every scenario and kernel and print the report
+    /// @param double, sample rate
+    /// @param int, block size
+    /// @return bool, true if everything is within tolerance
+    static bool run(double sampleRate, int blockSize)
+    {
+        bool passed = true;
+
+        std::printf("%-44s %10s %10s %8s %8s %9s  %s\n", "scenario", "max diff", "error(dB)", "ref(s)", "opt(s)", "speedup", "result");
+        for (auto& scenario : getScenarios())
+            passed &= print(compareScenario(scenario, sampleRate, blockSize));
+        passed &= print(compareParallelVoices(sampleRate, blockSize));
+
+        std::printf("\n%-44s %10s %10s %8s %8s %9s  %s\n", "kernel", "max diff", "error(dB)", "ref(s)", "opt(s)", "speedup", "result");
+        for (auto& kernel : compareKernels((float) sampleRate, blockSize))
+            passed &= print(kernel);
+
+        std::printf("\n%s\n", passed ? "all within tolerance" : "FAILED");
+        return passed;
+    }
+
+private:
+    static constexpr double exact = -std::numeric_limits<double>::infinity();   // tolerance of bit-exact results
+    static constexpr double reverbTailTolerance = -100.0;                         // the processor clears a reverb tail once it is below -100 dBFS
+
+    struct Scenario
+    {
+        const char* name;
+        const char* parameters;   // applied on top of commonParameters
+        double toleranceDb;       // error level relative to the reference, exact for bit-exact
+    };
+
+    struct Result
+    {
+        juce::String name;
+        double maxDiff = 0.0;
+        double errorDb = exact;
+        double toleranceDb = exact;
+        double referenceSeconds = 0.0;
+        double optimisedSeconds = 0.0;
+        bool finite = true;       // false if either output contains NaN or inf
+
+        bool isWithinTolerance() const
+        {
+            if (!finite)
+                return false;
+
+            return toleranceDb == exact ? maxDiff == 0.0 : errorDb <= toleranceDb;
+        }
+    };
+
+    // Tolerances: the coefficient cache is specified to 0.01 dB of magnitude error, about -58 dB of signal error.
+    // Control-rate filter modulation holds the cutoff for 32 samples, control-rate FM ramps the frequency
+    // offset and the phase difference accumulates, so those only guard against gross breakage.
+    static constexpr double cacheTolerance = -58.0;
+    // A biquad and a state-variable filter with the same transfer function respond differently while the
+    // cutoff moves (the biquad's delays hold the old coefficients' state), the swept comparison shows that.
+    static constexpr double stateVariableTolerance = -40.0;
+    // The sines are FastMath::sin2Pi() against the reference's std::sin(), precise for the oscillators and
+    // normal for the LFOs: a few ulps, and the LFO's error integrated into the phase where it modulates the pitch.
+    static constexpr double fastMathTolerance = -100.0;
+
+    // short envelopes so the chord pattern never needs more than 8 voices (no stealing on either side)
+    static constexpr const char* commonParameters = "Polyphony=8,attack1=0.1,attack2=0.1,release1=0.2,release2=0.2,"
+                                                    "LFO1AmountParam=50,LFO1FreqParam=1.5,LFO2AmountParam=30,LFO2Waveshape=1";
+
+    // The PM destinations are not compared: the reference voice adds them to the unused amplitude offset.
+    // The tri/square FM scenario keeps the frequency deviation below the lowest note (65 Hz): the reference
+    // does not wrap a phase that runs backwards, the oscillators now do (through-zero FM).
+    static std::vector<Scenario> getScenarios()
+    {
+        return {
+            { "sine/saw, unison 4+3, LFO AM, per sample",     "Osc1Waveshape=0,Osc2Waveshape=2,Osc1Unison=3,Osc2Unison=2,LFO1Destination=0,LFO2Destination=1,ModulationRate=0", fastMathTolerance },
+            { "tri/square, unison 8+2, LFO FM, per sample",   "Osc1Waveshape=1,Osc2Waveshape=3,Osc1Unison=7,Osc2Unison=1,LFO1Destination=2,LFO2Destination=3,ModulationRate=0,LFO1AmountParam=10,LFO2AmountParam=10", fastMathTolerance },
+            { "saw/sine, reverb, LFO AM/FM, per sample",      "Osc1Waveshape=2,Osc2Waveshape=0,Osc1Unison=4,Osc2Unison=0,LFO1Destination=1,LFO2Destination=2,ModulationRate=0,Reverb=1", reverbTailTolerance },
+            { "low pass, cutoff LFO, per sample",             "Osc1Waveshape=2,Osc2Waveshape=3,Osc1Unison=3,FilterOn=1,filterType=0,cutOff=400,Q=0.7,LFO1Destination=6,LFO2Destination=0,ModulationRate=0", cacheTolerance },
+            { "band pass, per sample",                        "Osc1Waveshape=2,Osc2Waveshape=1,Osc1Unison=2,FilterOn=1,filterType=2,cutOff=600,Q=0.3,LFO1Destination=0,LFO2Destination=1,ModulationRate=0", cacheTolerance },
+            { "unison 8+8, LFO AM, control rate 32",          "Osc1Waveshape=2,Osc2Waveshape=3,Osc1Unison=7,Osc2Unison=7,LFO1Destination=0,LFO2Destination=1,ModulationRate=2", exact },
+            { "high pass, cutoff LFO, control rate 32",       "Osc1Waveshape=2,Osc2Waveshape=2,Osc1Unison=3,FilterOn=1,filterType=1,cutOff=700,Q=0.5,LFO1Destination=6,LFO2Destination=6,ModulationRate=2", -30.0 },
+            { "LFO FM, control rate 16",                      "Osc1Waveshape=0,Osc2Waveshape=1,Osc1Unison=2,Osc2Unison=2,LFO1Destination=2,LFO2Destination=3,ModulationRate=1", -15.0 },
+        };
+    }
+
+    static Result compareScenario(const Scenario& scenario, double sampleRate, int blockSize)
+    {
+        const auto sequence = OfflineRender::makeChordPattern(4, 6.0);
+
+        RenderSettings settings;
+        settings.sampleRate = sampleRate;
+        settings.blockSize = blockSize;
+        settings.tailSeconds = 1.0;
+
+        PolyphonicSynthAudioProcessor optimised;
+        OfflineRender::applyParameters(optimised, commonParameters);
+        OfflineRender::applyParameters(optimised, scenario.parameters);
+
+        reference::ReferenceProcessor reference(optimised);
+
+        juce::AudioBuffer<float> referenceAudio, optimisedAudio;
+        const auto referenceRender = OfflineRender::render(reference, sequence, settings, &referenceAudio);
+        const auto optimisedRender = OfflineRender::render(optimised, sequence, settings, &optimisedAudio);
+
+        Result result;
+        result.name = scenario.name;
+        result.toleranceDb = scenario.toleranceDb;
+        result.referenceSeconds = referenceRender.renderSeconds;
+        result.optimisedSeconds = optimisedRender.renderSeconds;
+
+        for (int chan = 0; chan < referenceAudio.getNumChannels(); chan++)
+            measure(result, referenceAudio.getReadPointer(chan), optimisedAudio.getReadPointer(chan), referenceAudio.getNumSamples());
+
+        return result;
+    }
+
+    /// render the same MIDI with ParallelVoices off (the "reference" columns) and on; the renderer mixes the
+    /// voices in the serial order, so the outputs are bit-identical. 16-note chords keep several lane groups
+    /// active. On a single core the renderer has no workers and the voices render serially on both sides.
+    static Result compareParallelVoices(double sampleRate, int blockSize)
+    {
+        const auto sequence = OfflineRender::makeChordPattern(16, 6.0);
+        const char* parameters = "Polyphony=32,Osc1Waveshape=2,Osc2Waveshape=3,Osc1Unison=3,Osc2Unison=1,"
+                                 "FilterOn=1,filterType=0,cutOff=900,Q=0.7,LFO1Destination=6,LFO2Destination=0,ModulationRate=2";
+
+        RenderSettings settings;
+        settings.sampleRate = sampleRate;
+        settings.blockSize = blockSize;
+        settings.tailSeconds = 1.0;
+
+        PolyphonicSynthAudioProcessor serial, parallel;
+        for (auto* processor : { &serial, &parallel })
+        {
+            OfflineRender::applyParameters(*processor, commonParameters);
+            OfflineRender::applyParameters(*processor, parameters);
+        }
+        OfflineRender::applyParameters(parallel, "ParallelVoices=1");
+
+        juce::AudioBuffer<float> serialAudio, parallelAudio;
+        const auto serialRender = OfflineRender::render(serial, sequence, settings, &serialAudio);
+        const auto parallelRender = OfflineRender::render(parallel, sequence, settings, &parallelAudio);
+
+        Result result;
+        result.name = "parallel voices against serial, 16 notes";
+        result.toleranceDb = exact;
+        result.referenceSeconds = serialRender.renderSeconds;
+        result.optimisedSeconds = parallelRender.renderSeconds;
+
+        for (int chan = 0; chan < serialAudio.getNumChannels(); chan++)
+            measure(result, serialAudio.getReadPointer(chan), parallelAudio.getReadPointer(chan), serialAudio.getNumSamples());
+
+        return result;
+    }
+
+    /// add the difference of two signals to a result, the error level is kept for the worst channel
+    static void measure(Result& result, const float* reference, const float* optimised, int numSamples)
+    {
+        double signal = 0.0, error = 0.0;
+        for (int i = 0; i < numSamples; i++)
+        {
+            if (!std::isfinite(reference[i]) || !std::isfinite(optimised[i]))
+            {
+                result.finite = false;
+                continue;
+            }
+
+            const double diff = (double) optimised[i] - reference[i];
+            result.maxDiff = juce::jmax(result.maxDiff, std::abs(diff));
+            signal += (double) reference[i] * reference[i];
+            error += diff * diff;
+        }
+
+        if (error > 0.0)
+            result.errorDb = juce::jmax(result.errorDb, 10.0 * std::log10(error / juce::jmax(signal, 1.0e-30)));
+    }
+
+    /// time two block renderers over the same number of samples and compare what they produce
+    static Result compareKernel(const char* name, double toleranceDb, int numSamples, int blockSize,
+                                const std::function<void(float*, int)>& renderReference,
+                                const std::function<void(float*, int)>& renderOptimised)
+    {
+        std::vector<float> referenceOutput((size_t) numSamples), optimisedOutput((size_t) numSamples);
+
+        auto time = [numSamples, blockSize](const std::function<void(float*, int)>& render, float* dest)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (int pos = 0; pos < numSamples; pos += blockSize)
+                render(dest + pos, juce::jmin(blockSize, numSamples - pos));
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        Result result;
+        result.name = name;
+        result.toleranceDb = toleranceDb;
+        result.referenceSeconds = time(renderReference, referenceOutput.data());
+        result.optimisedSeconds = time(renderOptimised, optimisedOutput.data());
+        measure(result, referenceOutput.data(), optimisedOutput.data(), numSamples);
+        return result;
+    }
+
+    /// voice of a lane group that renders a constant Osc1 and a silent Osc2, so the lane's output
+    /// is its Osc1 envelope (the group's mix scales it by 0.1)
+    struct EnvelopeProbe : public BankVoice
+    {
+        bool active = false;
+
+        bool isLaneActive() const override { return active; }
+        void laneEnded() override { active = false; }
+
+        void renderChunk(VoiceLane& _lane) override
+        {
+            for (int i = 0; i < _lane.getNumSamples(); i++)
+                _lane.setOscillators(i, 1.0f, 0.0f);
+        }
+    };
+
+    /// filter kernel input: a 110 Hz saw, and a cutoff offset sweeping +-300 Hz at 2 Hz
+    struct SweptSaw
+    {
+        float sampleRate;
+        float phase = 0.0f, sweepPhase = 0.0f;
+
+        float nextSample()
+        {
+            phase += 110.0f / sampleRate;
+            if (phase > 1.0f)
+                phase -= 1.0f;
+            return phase - 0.5f;
+        }
+
+        float nextSweep()
+        {
+            sweepPhase += 2.0f / sampleRate;
+            if (sweepPhase > 1.0f)
+                sweepPhase -= 1.0f;
+            return 300.0f * std::sin(juce::MathConstants<float>::twoPi * sweepPhase);
+        }
+    };
+
+    static std::vector<Result> compareKernels(float sampleRate, int blockSize)
+    {
+        const int numSamples = (int) sampleRate * 20;
+        const float frequency = 220.0f;
+        std::vector<Result> results;
+
+        // main oscillator: OscSwitch per sample -> OscKernel block
+        static const char* oscillatorNames[] = { "oscillator sine", "oscillator triangle", "oscillator saw", "oscillator square" };
+        for (int shape = 0; shape < 4; shape++)
+        {
+            reference::OscSwitch referenceOsc;
+            OscSwitch osc;
+            referenceOsc.startNote(sampleRate, shape, (int) frequency);
+            osc.startNote(sampleRate, shape, (int) frequency);
+            std::vector<float> noOffsets((size_t) blockSize, 0.0f);
+
+            results.push_back(compareKernel(oscillatorNames[shape], shape == 0 ? fastMathTolerance : exact, numSamples, blockSize,
+                [&](float* dest, int n) { for (int i = 0; i < n; i++) dest[i] = referenceOsc.process(); },
+                [&](float* dest, int n) { osc.process(dest, noOffsets.data(), n); }));
+        }
+
+        // 7 unison voices: 7 OscSwitch per sample -> UnisonBank
+        {
+            const float detune = 30.0f;
+            reference::OscSwitch referenceUnison[8];
+            for (int i = 1; i < 8; i++)
+                referenceUnison[i].startNote(sampleRate, 2, frequency + 0.1 * detune * i);
+
+            UnisonBank bank;
+            bank.startNote(sampleRate, 2, frequency, detune, 7);
+
+            results.push_back(compareKernel("unison saw x7", exact, numSamples, blockSize,
+                [&](float* dest, int n)
+                {
+                    for (int i = 0; i < n; i++)
+                    {
+                        float sum = 0.0f;
+                        for (int v = 1; v < 8; v++)
+                            sum += referenceUnison[v].process();
+                        dest[i] = sum;
+                    }
+                },
+                [&](float* dest, int n) { bank.process(dest, n); }));
+        }
+
+        // LFO: per sample -> block
+        {
+            reference::LFO referenceLfo;
+            LFO lfo;
+            referenceLfo.startNote(sampleRate, 1, 1.5f, 50.0f);
+            lfo.startNote(sampleRate, 1, 1.5f, 50.0f);
+
+            results.push_back(compareKernel("LFO triangle", exact, numSamples, blockSize,
+                [&](float* dest, int n) { for (int i = 0; i < n; i++) dest[i] = referenceLfo.process(); },
+                [&](float* dest, int n) { lfo.process(dest, n); }));
+        }
+
+        // envelope: juce::ADSR per sample -> the envelopes of a VoiceLaneGroup, run on one lane,
+        // a note every half second released after a quarter
+        {
+            const juce::ADSR::Parameters parameters { 0.05f, 0.1f, 0.6f, 0.08f };
+            const int notePeriod = (int) sampleRate / 2;
+            juce::ADSR referenceEnvelope;
+            referenceEnvelope.setSampleRate(sampleRate);
+            referenceEnvelope.setParameters(parameters);
+
+            const std::vector<float> fullLevel((size_t) blockSize, 1.0f), noLevel((size_t) blockSize, 0.0f);
+            SynthParameters voiceParameters;
+            voiceParameters.level[0] = fullLevel.data();
+            voiceParameters.level[1] = noLevel.data();
+
+            EnvelopeProbe probe;
+            VoiceLaneGroup group;
+            group.setParameters(&voiceParameters);
+            group.setBlockStride(blockSize);
+            group.setVoice(0, &probe);
+            int referencePosition = 0, position = 0;
+
+            results.push_back(compareKernel("envelope", exact, numSamples, blockSize,
+                [&](float* dest, int n)
+                {
+                    for (int i = 0; i < n; i++, referencePosition++)
+                    {
+                        if (referencePosition % notePeriod == 0)
+                            referenceEnvelope.noteOn();
+                        else if (referencePosition % notePeriod == notePeriod / 2)
+                            referenceEnvelope.noteOff();
+                        dest[i] = (float) (referenceEnvelope.getNextSample() * 0.1);
+                    }
+                },
+                [&](float* dest, int n)
+                {
+                    // the group leaves the block of an idle lane untouched
+                    juce::FloatVectorOperations::clear(dest, n);
+
+                    // the events split the block like MIDI events split the synth's blocks
+                    for (int done = 0; done < n;)
+                    {
+                        if (position % notePeriod == 0)
+                        {
+                            probe.active = true;
+                            group.startNote(0, sampleRate, parameters, parameters);
+                        }
+                        else if (position % notePeriod == notePeriod / 2)
+                        {
+                            group.stopNote(0);
+                        }
+
+                        const int untilEvent = notePeriod / 2 - position % (notePeriod / 2);
+                        const int length = juce::jmin(n - done, untilEvent);
+                        group.renderMono(dest + done, done, length);
+                        done += length;
+                        position += length;
+                    }
+                }));
+        }
+
+        // filter: exact coefficients every sample -> coefficient cache, every sample and at control rate
+        FilterCoefficientCache cache;
+        cache.prepare(sampleRate);
+
+        for (int interval : { 1, 32 })
+        {
+            reference::Filter referenceFilter;
+            Filter filter;
+            filter.setCoefficientCache(&cache);
+            referenceFilter.startNote(sampleRate, 400.0f, 0.7f, 0);
+            filter.startNote(sampleRate, 400.0f, 0.7f, 0);
+
+            SweptSaw referenceInput { sampleRate }, input { sampleRate };
+            int samplesUntilUpdate = 0;
+
+            results.push_back(compareKernel(interval == 1 ? "filter, swept, per sample" : "filter, swept, control rate 32", interval == 1 ? cacheTolerance : -30.0, numSamples, blockSize,
+                [&](float* dest, int n)
+                {
+                    for (int i = 0; i < n; i++)
+                    {
+                        referenceFilter.setFrequencyOffset(referenceInput.nextSweep());
+                        dest[i] = referenceFilter.process(referenceInput.nextSample(), 0);
+                    }
+                },
+                [&](float* dest, int n)
+                {
+                    for (int i = 0; i < n; i++)
+                    {
+                        const float sweep = input.nextSweep();
+                        if (--samplesUntilUpdate <= 0)
+                        {
+                            filter.setFrequencyOffset(sweep);
+                            filter.updateCoefficients(0);
+                            samplesUntilUpdate = interval;
+                        }
+                        dest[i] = filter.processSample(input.nextSample());
+                    }
+                }));
+        }
+
+        // state-variable low pass: the same transfer function as the reference's biquad low pass, its cutoff
+        // recalculated every sample with the tan approximation; they only differ while the cutoff moves
+        {
+            reference::Filter referenceFilter;
+            Filter filter;
+            referenceFilter.startNote(sampleRate, 400.0f, 0.7f, 0);
+            filter.startNote(sampleRate, 400.0f, 0.7f, Filter::firstStateVariableType + StateVariableCoefficients::lowPass);
+
+            SweptSaw referenceInput { sampleRate }, input { sampleRate };
+
+            results.push_back(compareKernel("state-variable filter, swept, per sample", stateVariableTolerance, numSamples, blockSize,
+                [&](float* dest, int n)
+                {
+                    for (int i = 0; i < n; i++)
+                    {
+                        referenceFilter.setFrequencyOffset(referenceInput.nextSweep());
+                        dest[i] = referenceFilter.process(referenceInput.nextSample(), 0);
+                    }
+                },
+                [&](float* dest, int n)
+                {
+                    for (int i = 0; i < n; i++)
+                    {
+                        filter.setFrequencyOffset(input.nextSweep());
+                        filter.updateCoefficients(Filter::firstStateVariableType + StateVariableCoefficients::lowPass);
+                        dest[i] = filter.processSample(input.nextSample());
+                    }
+                }));
+        }
+
+        return results;
+    }
+
+    static bool print(const Result& result)
+    {
+        const bool ok = result.isWithinTolerance();
+        const double speedup = result.optimisedSeconds > 0.0 ? result.referenceSeconds / result.optimisedSeconds : 0.0;
+        if (!result.finite)
+        {
+            std::printf("%-44s output is not finite  FAIL\n", result.name.toRawUTF8());
+            return false;
+        }
+
+        const auto tolerance = result.toleranceDb == exact ? juce::String("bit-exact") : "<= " + juce::String(result.toleranceDb, 0) + " dB";
+
+        if (result.errorDb == exact)
+            std::printf("%-44s %10.3g %10s %8.3f %8.3f %8.2fx  %s (%s)\n", result.name.toRawUTF8(), result.maxDiff, "exact",
+                        result.referenceSeconds, result.optimisedSeconds, speedup, ok ? "ok" : "FAIL", tolerance.toRawUTF8());
+        else
+            std::printf("%-44s %10.3g %10.1f %8.3f %8.3f %8.2fx  %s (%s)\n", result.name.toRawUTF8(), result.maxDiff, result.errorDb,
+                        result.referenceSeconds, result.optimisedSeconds, speedup, ok ? "ok" : "FAIL", tolerance.toRawUTF8());
+
+        return ok;
+    }
+};
+
+#endif // GOLDEN_COMPARE_H
@@ -0,0 +1,220 @@
+/*
+  ==============================================================================
+
+    Headless offline renderer and real-time benchmark for PolyphonicSynth.
+
+    Renders a MIDI file (or a generated chord pattern) through the plugin's
+    processor, without an editor, for every combination of the requested
+    sample rates and block sizes, and reports the real-time factor and the
+    per-block timings.
+
+  ==============================================================================
+*/
+
+#include <cstdio>
+#include <memory>
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include "OfflineRender.h"
+#include "GoldenCompare.h"
+#include "PresetBankBench.h"
+#include "FastMathBench.h"
+
+//==============================================================================
+static void printUsage()
+{
+    std::printf("usage: PolyphonicSynthBenchmark [options]\n"
+                "  --midi <file.mid>        MIDI file to render (default: generated chord pattern)\n"
+                "  --state <file>           plugin state, saved by getStateInformation() or as .xml\n"
+                "  --params id=value,...    parameter overrides in real units, e.g. Polyphony=32,FilterOn=1\n"
+                "  --ir <file.wav>          impulse response of the convolution reverb (Reverb=1,ReverbType=1)\n"
+                "  --rate 44100,48000       sample rates (default 48000)\n"
+                "  --block 64,128,512       block sizes (default 512)\n"
+                "  --tail <seconds>         rendered after the last event (default 2)\n"
+                "  --notes <n>              notes per chord of the generated pattern (default 8)\n"
+                "  --length <seconds>       length of the generated pattern (default 10)\n"
+                "  --cc <events/s>          pitch and mod wheel events per second added to the pattern (default 0)\n"
+                "  --out <file.wav>         write the audio of the first configuration\n"
+                "  --compare                compare the optimised engine with the frozen scalar reference\n"
+                "                           (first --rate and --block), exits with 1 if a result is out of tolerance\n"
+                "  --bank <n>               write a preset bank of n random presets, time opening, searching and\n"
+                "                           parsing it, exits with 1 if a preset doesn't read back\n"
+                "  --math                   time the FastMath approximations against libm and check their errors,\n"
+                "                           exits with 1 if an error is above its documented maximum\n");
+}
+
+/// comma separated list of numbers, or the default when the option is missing
+static juce::Array<double> parseList(const juce::ArgumentList& args, const juce::String& option, double defaultValue)
+{
+    juce::Array<double> values;
+    for (auto& token : juce::StringArray::fromTokens(args.getValueForOption(option), ",", {}))
+        if (token.trim().isNotEmpty())
+            values.add(token.getDoubleValue());
+
+    if (values.isEmpty())
+        values.add(defaultValue);
+
+    return values;
+}
+
+static bool loadMidiFile(const juce::File& file, juce::MidiMessageSequence& sequence)
+{
+    juce::FileInputStream stream(file);
+    juce::MidiFile midiFile;
+    if (!stream.openedOk() || !midiFile.readFrom(stream))
+        return false;
+
+    midiFile.convertTimestampTicksToSeconds();
+    for (int track = 0; track < midiFile.getNumTracks(); track++)
+        sequence.addSequence(*midiFile.getTrack(track), 0.0);
+
+    sequence.sort();
+    sequence.updateMatchedPairs();
+    return true;
+}
+
+/// restore a state saved by the plugin, either the binary getStateInformation() data or its XML
+static bool loadState(juce::AudioProcessor& processor, const juce::File& file)
+{
+    juce::MemoryBlock data;
+
+    if (file.hasFileExtension("xml"))
+    {
+        auto xml = juce::XmlDocument::parse(file);
+        if (xml == nullptr)
+            return false;
+
+        juce::AudioProcessor::copyXmlToBinary(*xml, data);
+    }
+    else if (!file.loadFileAsData(data))
+    {
+        return false;
+    }
+
+    processor.setStateInformation(data.getData(), (int) data.getSize());
+    return true;
+}
+
+static bool writeWav(const juce::File& file, const juce::AudioBuffer<float>& audio, double sampleRate)
+{
+    file.deleteFile();
+    auto stream = std::make_unique<juce::FileOutputStream>(file);
+    if (!stream->openedOk())
+        return false;
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate, (unsigned int) audio.getNumChannels(), 24, {}, 0));
+    if (writer == nullptr)
+        return false;
+
+    stream.release();   // owned by the writer now
+    return writer->writeFromAudioSampleBuffer(audio, 0, audio.getNumSamples());
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;   // the parameter tree uses timers and the message thread
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    const auto sampleRates = parseList(args, "--rate", 48000.0);
+    const auto blockSizes = parseList(args, "--block", 512.0);
+
+    if (args.containsOption("--compare"))
+        return GoldenCompare::run(sampleRates[0], (int) blockSizes[0]) ? 0 : 1;
+
+    if (args.containsOption("--bank"))
+        return PresetBankBench::run(juce::jmax(1, args.getValueForOption("--bank").getIntValue())) ? 0 : 1;
+
+    if (args.containsOption("--math"))
+        return FastMathBench::run() ? 0 : 1;
+
+    juce::MidiMessageSequence sequence;
+    if (args.containsOption("--midi"))
+    {
+        const auto midiFile = args.getExistingFileForOption("--midi");
+        if (!loadMidiFile(midiFile, sequence))
+        {
+            std::printf("cannot read MIDI file %s\n", midiFile.getFullPathName().toRawUTF8());
+            return 1;
+        }
+    }
+    else
+    {
+        const int numNotes = args.containsOption("--notes") ? args.getValueForOption("--notes").getIntValue() : 8;
+        const double length = args.containsOption("--length") ? args.getValueForOption("--length").getDoubleValue() : 10.0;
+        sequence = OfflineRender::makeChordPattern(numNotes, length);
+
+        if (args.containsOption("--cc"))
+            OfflineRender::addControllerStream(sequence, args.getValueForOption("--cc").getDoubleValue(), length);
+    }
+
+    const double tail = args.containsOption("--tail") ? args.getValueForOption("--tail").getDoubleValue() : 2.0;
+
+    std::printf("%8s %6s %10s %10s %9s %9s %9s %9s %9s %8s\n",
+                "rate", "block", "audio(s)", "render(s)", "RTF", "p50(us)", "p99(us)", "p99.9(us)", "max(us)", "max(%)");
+
+    bool wroteOutput = false;
+
+    for (auto sampleRate : sampleRates)
+    {
+        for (auto blockSize : blockSizes)
+        {
+            // a fresh processor for every configuration, so no voice or reverb state carries over
+            auto processor = std::make_unique<PolyphonicSynthAudioProcessor>();
+
+            if (args.containsOption("--state") && !loadState(*processor, args.getExistingFileForOption("--state")))
+            {
+                std::printf("cannot read state file\n");
+                return 1;
+            }
+
+            if (args.containsOption("--params") && !OfflineRender::applyParameters(*processor, args.getValueForOption("--params")))
+                return 1;
+
+            if (args.containsOption("--ir"))
+            {
+                // loaded in the background, the render starts once it is ready
+                processor->loadImpulseResponse(args.getExistingFileForOption("--ir"));
+                while (processor->getConvolutionReverb().isLoading())
+                    juce::Thread::sleep(1);
+
+                if (!processor->getConvolutionReverb().isReady())
+                {
+                    std::printf("cannot read impulse response\n");
+                    return 1;
+                }
+            }
+
+            RenderSettings settings;
+            settings.sampleRate = sampleRate;
+            settings.blockSize = (int) blockSize;
+            settings.tailSeconds = tail;
+
+            const bool writeOutput = args.containsOption("--out") && !wroteOutput;
+            juce::AudioBuffer<float> audio;
+            const auto result = OfflineRender::render(*processor, sequence, settings, writeOutput ? &audio : nullptr);
+
+            std::printf("%8.0f %6d %10.2f %10.3f %9.4f %9.1f %9.1f %9.1f %9.1f %7.1f%%  (worst block %d)\n",
+                        sampleRate, settings.blockSize, result.audioSeconds, result.renderSeconds, result.getRealTimeFactor(),
+                        result.getPercentile(50.0) * 1.0e6, result.getPercentile(99.0) * 1.0e6, result.getPercentile(99.9) * 1.0e6,
+                        result.getWorstBlockTime() * 1.0e6, 100.0 * result.getWorstBlockTime() / result.blockSeconds, result.worstBlock);
+
+            if (writeOutput)
+            {
+                const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--out"));
+                if (!writeWav(file, audio, sampleRate))
+                    std::printf("cannot write %s\n", file.getFullPathName().toRawUTF8());
+                wroteOutput = true;
+            }
+        }
+    }
+
+    return 0;
+}
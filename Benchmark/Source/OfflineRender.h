@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+    OfflineRender.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef OFFLINE_RENDER_H
+#define OFFLINE_RENDER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <JuceHeader.h>
+
+/// Settings of one offline render.
+struct RenderSettings
+{
+    double sampleRate = 48000.0;
+    int blockSize = 512;
+    double tailSeconds = 2.0;                   // rendered after the last MIDI event
+};
+
+/// Timings of one offline render.
+struct RenderResult
+{
+    double audioSeconds = 0.0;                  // length of the rendered audio
+    double renderSeconds = 0.0;                 // time spent in processBlock
+    double blockSeconds = 0.0;                  // real-time budget of one block
+    std::vector<double> blockTimes;             // time spent in each processBlock call, in seconds
+    int worstBlock = 0;                         // index of the slowest block
+
+    /// render time / audio time, below 1 is faster than real time
+    double getRealTimeFactor() const
+    {
+        return audioSeconds > 0.0 ? renderSeconds / audioSeconds : 0.0;
+    }
+
+    /// block time at a percentile
+    /// @param double, percentile (0-100)
+    double getPercentile(double _percentile) const
+    {
+        if (blockTimes.empty())
+            return 0.0;
+
+        std::vector<double> sorted(blockTimes);
+        std::sort(sorted.begin(), sorted.end());
+
+        const auto index = (size_t) std::ceil(_percentile / 100.0 * (double) sorted.size());
+        return sorted[juce::jlimit((size_t) 1, sorted.size(), index) - 1];
+    }
+
+    double getWorstBlockTime() const
+    {
+        return blockTimes.empty() ? 0.0 : blockTimes[(size_t) worstBlock];
+    }
+};
+
+/// Renders a MIDI sequence through a processor block by block, as a host would, and times every block.
+class OfflineRender
+{
+public:
+    /// render the sequence
+    /// @param juce::AudioProcessor&, processor, prepared and released here
+    /// @param juce::MidiMessageSequence&, events with timestamps in seconds
+    /// @param RenderSettings&, sample rate, block size and tail
+    /// @param juce::AudioBuffer<float>*, receives the rendered audio when not nullptr
+    static RenderResult render(juce::AudioProcessor& processor, const juce::MidiMessageSequence& sequence,
+                               const RenderSettings& settings, juce::AudioBuffer<float>* output = nullptr)
+    {
+        const int numChannels = processor.getTotalNumOutputChannels();
+        const int blockSize = settings.blockSize;
+        const auto totalSamples = (int64_t) std::ceil((sequence.getEndTime() + settings.tailSeconds) * settings.sampleRate);
+        const int numBlocks = (int) ((totalSamples + blockSize - 1) / blockSize);
+
+        processor.setRateAndBufferSizeDetails(settings.sampleRate, blockSize);
+        processor.prepareToPlay(settings.sampleRate, blockSize);
+
+        juce::AudioBuffer<float> buffer(numChannels, blockSize);
+        juce::MidiBuffer midi;
+
+        if (output != nullptr)
+            output->setSize(numChannels, numBlocks * blockSize);
+
+        RenderResult result;
+        result.blockTimes.reserve((size_t) numBlocks);
+        result.audioSeconds = (double) numBlocks * blockSize / settings.sampleRate;
+        result.blockSeconds = blockSize / settings.sampleRate;
+
+        int nextEvent = 0;
+
+        for (int block = 0; block < numBlocks; block++)
+        {
+            const int64_t blockStart = (int64_t) block * blockSize;
+
+            // events falling in this block, at their sample offset
+            midi.clear();
+            for (; nextEvent < sequence.getNumEvents(); nextEvent++)
+            {
+                const auto& message = sequence.getEventPointer(nextEvent)->message;
+                const auto position = (int64_t) std::llround(message.getTimeStamp() * settings.sampleRate);
+                if (position >= blockStart + blockSize)
+                    break;
+
+                midi.addEvent(message, (int) juce::jmax((int64_t) 0, position - blockStart));
+            }
+
+            buffer.clear();
+
+            const auto start = std::chrono::steady_clock::now();
+            processor.processBlock(buffer, midi);
+            const auto end = std::chrono::steady_clock::now();
+
+            const double seconds = std::chrono::duration<double>(end - start).count();
+            result.blockTimes.push_back(seconds);
+            result.renderSeconds += seconds;
+            if (seconds > result.blockTimes[(size_t) result.worstBlock])
+                result.worstBlock = block;
+
+            if (output != nullptr)
+                for (int chan = 0; chan < numChannels; chan++)
+                    output->copyFrom(chan, block * blockSize, buffer, chan, 0, blockSize);
+        }
+
+        processor.releaseResources();
+        return result;
+    }
+
+    /// set parameters from a list of assignments in real units, e.g. "Polyphony=32,FilterOn=1"
+    static bool applyParameters(juce::AudioProcessor& processor, const juce::String& list)
+    {
+        for (auto& assignment : juce::StringArray::fromTokens(list, ",", {}))
+        {
+            const auto id = assignment.upToFirstOccurrenceOf("=", false, false).trim();
+            const auto value = assignment.fromFirstOccurrenceOf("=", false, false).getFloatValue();
+
+            juce::RangedAudioParameter* parameter = nullptr;
+            for (auto* p : processor.getParameters())
+                if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(p); ranged != nullptr && ranged->getParameterID() == id)
+                    parameter = ranged;
+
+            if (parameter == nullptr)
+            {
+                std::printf("unknown parameter: %s\n", id.toRawUTF8());
+                return false;
+            }
+
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        }
+
+        return true;
+    }
+
+    /// chords of numNotes notes every half second, each held for 0.45 s
+    static juce::MidiMessageSequence makeChordPattern(int numNotes, double lengthSeconds)
+    {
+        juce::MidiMessageSequence sequence;
+        static const int intervals[] = { 0, 4, 7, 11, 14, 17, 21, 24 };
+
+        for (double time = 0.0; time < lengthSeconds; time += 0.5)
+        {
+            const int root = 36 + ((int) (time * 2.0) * 5) % 24;
+
+            for (int i = 0; i < numNotes; i++)
+            {
+                const int note = juce::jlimit(0, 127, root + intervals[i % 8] + 24 * (i / 8));
+                sequence.addEvent(juce::MidiMessage::noteOn(1, note, 0.8f).withTimeStamp(time));
+                sequence.addEvent(juce::MidiMessage::noteOff(1, note).withTimeStamp(time + 0.45));
+            }
+        }
+
+        sequence.sort();
+        sequence.updateMatchedPairs();
+        return sequence;
+    }
+
+    /// add a steady stream of controller events, alternating a pitch wheel vibrato and mod wheel moves
+    /// @param juce::MidiMessageSequence&, sequence to add to
+    /// @param double, events per second
+    /// @param double, length in seconds
+    static void addControllerStream(juce::MidiMessageSequence& sequence, double eventsPerSecond, double lengthSeconds)
+    {
+        if (eventsPerSecond <= 0.0)
+            return;
+
+        int count = 0;
+        for (double time = 0.0; time < lengthSeconds; time += 1.0 / eventsPerSecond, count++)
+        {
+            const double vibrato = std::sin(juce::MathConstants<double>::twoPi * 5.0 * time);
+
+            if (count % 2 == 0)
+                sequence.addEvent(juce::MidiMessage::pitchWheel(1, 8192 + (int) (1024.0 * vibrato)).withTimeStamp(time));
+            else
+                sequence.addEvent(juce::MidiMessage::controllerEvent(1, 1, (int) (64.0 + 63.0 * vibrato)).withTimeStamp(time));
+        }
+
+        sequence.sort();
+        sequence.updateMatchedPairs();
+    }
+};
+
+#endif // OFFLINE_RENDER_H
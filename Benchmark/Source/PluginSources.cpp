@@ -0,0 +1,21 @@
+/*
+  ==============================================================================
+
+    PluginSources.cpp
+
+    Compiles the plugin's processor and editor into the benchmark (the
+    processor's createEditor() needs the editor to link). The plugin project gets
+    these values from the JucePluginDefines.h Projucer generates for it, they
+    match the pluginCharacteristicsValue of PolyphonicSynth.jucer.
+
+  ==============================================================================
+*/
+
+#define JucePlugin_Name                 "PolyphonicSynth"
+#define JucePlugin_IsSynth              1
+#define JucePlugin_WantsMidiInput       1
+#define JucePlugin_ProducesMidiOutput   0
+#define JucePlugin_IsMidiEffect         0
+
+#include "../../Source/PluginProcessor.cpp"
+#include "../../Source/PluginEditor.cpp"
@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    PresetBankBench.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef PRESET_BANK_BENCH_H
+#define PRESET_BANK_BENCH_H
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+/// Writes a bank of random presets, then times opening it, the searches of a preset browser and
+/// the parsing of every preset, and checks that every preset reads back with the values it was saved with.
+/// The same presets are also restored as plugin states, from the binary chunk and from the XML of the
+/// parameter tree that earlier versions saved, and both times are printed.
+class PresetBankBench
+{
+public:
+    /// @param int, number of presets in the bank
+    /// @return bool, true if every check passed
+    static bool run(int numPresets)
+    {
+        using Clock = std::chrono::steady_clock;
+        auto secondsSince = [](Clock::time_point _start) { return std::chrono::duration<double>(Clock::now() - _start).count(); };
+
+        static const char* categories[] = { "Bass", "Lead", "Pad", "Pluck", "Keys", "FX" };
+        static const char* characters[] = { "Bright", "Dark", "Wide", "Mono", "Evolving", "Short" };
+
+        PolyphonicSynthAudioProcessor processor;
+        auto& library = processor.getPresetLibrary();
+        juce::Random random(1);
+
+        std::vector<BankPreset> presets;
+        std::vector<std::vector<float>> values;
+        std::vector<juce::MemoryBlock> binaryStates((size_t) numPresets), xmlStates((size_t) numPresets);
+        for (int i = 0; i < numPresets; i++)
+        {
+            for (auto* parameter : processor.getParameters())
+                parameter->setValueNotifyingHost(random.nextFloat());
+
+            const juce::String category = categories[random.nextInt(6)];
+            presets.push_back(library.createBankPreset(category + " " + juce::String(i).paddedLeft('0', 5),
+                                                       { category, characters[random.nextInt(6)] }));
+
+            values.emplace_back();
+            for (auto* parameter : processor.getParameters())
+                if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+                    values.back().push_back(ranged->convertFrom0to1(ranged->getValue()));
+
+            // the chunk of getStateInformation(), and the one of earlier versions: the parameter tree's XML
+            processor.getStateInformation(binaryStates[(size_t) i]);
+            juce::XmlElement tree("ParameterTree");
+            for (auto* parameter : processor.getParameters())
+                if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+                {
+                    auto* element = tree.createNewChildElement("PARAM");
+                    element->setAttribute("id", ranged->getParameterID());
+                    element->setAttribute("value", (double) ranged->convertFrom0to1(ranged->getValue()));
+                }
+            juce::AudioProcessor::copyXmlToBinary(tree, xmlStates[(size_t) i]);
+        }
+
+        const auto file = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("PolyphonicSynthBenchmark.psbank");
+
+        auto start = Clock::now();
+        if (!PresetBank::write(file, presets))
+        {
+            std::printf("cannot write %s\n", file.getFullPathName().toRawUTF8());
+            return false;
+        }
+        const double writeSeconds = secondsSince(start);
+
+        start = Clock::now();
+        auto bank = PresetBank::open(file);
+        const double openSeconds = secondsSince(start);
+
+        if (bank == nullptr || bank->getNumPresets() != numPresets)
+        {
+            std::printf("cannot open %s\n", file.getFullPathName().toRawUTF8());
+            return false;
+        }
+
+        bool passed = true;
+        constexpr int numQueries = 1000;
+
+        // names differ in their number, the first digits select a run of presets
+        start = Clock::now();
+        for (int q = 0; q < numQueries; q++)
+        {
+            const int index = random.nextInt(numPresets);
+            const auto name = bank->getName(index);
+            const auto found = bank->findByName(name.substring(0, name.length() - 2));
+            passed = passed && found.getStart() <= index && index < found.getEnd();
+        }
+        const double nameSeconds = secondsSince(start) / numQueries;
+
+        start = Clock::now();
+        size_t numTagged = 0;
+        for (int q = 0; q < numQueries; q++)
+            numTagged += bank->findByTags((juce::uint64) 1 << random.nextInt(bank->getTagNames().size())).size();
+        const double tagSeconds = secondsSince(start) / numQueries;
+
+        start = Clock::now();
+        for (int q = 0; q < numQueries; q++)
+        {
+            const int index = random.nextInt(numPresets);
+            const auto similar = bank->findSimilar(bank->getFingerprint(index), 10);
+            passed = passed && !similar.empty() && bank->getFingerprint(similar[0]) == bank->getFingerprint(index);
+        }
+        const double similarSeconds = secondsSince(start) / numQueries;
+
+        // every preset is restored, the parameters change each time as when a host recalls states
+        auto restore = [&](const std::vector<juce::MemoryBlock>& states, int& mismatches)
+        {
+            const auto restoreStart = Clock::now();
+            for (auto& state : states)
+                processor.setStateInformation(state.getData(), (int) state.getSize());
+            const double seconds = secondsSince(restoreStart) / numPresets;
+
+            // the last state restored holds the values of the last preset created
+            size_t v = 0;
+            for (auto* parameter : processor.getParameters())
+                if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+                {
+                    const float expected = values.back()[v++];
+                    if (std::abs(ranged->convertFrom0to1(ranged->getValue()) - expected) > 1.0e-4f * juce::jmax(1.0f, std::abs(expected)))
+                        mismatches++;
+                }
+
+            return seconds;
+        };
+
+        int binaryMismatches = 0, xmlMismatches = 0;
+        const double binaryRestoreSeconds = restore(binaryStates, binaryMismatches);
+        const double xmlRestoreSeconds = restore(xmlStates, xmlMismatches);
+        passed = passed && binaryMismatches == 0 && xmlMismatches == 0;
+
+        std::vector<std::unique_ptr<PresetState>> parsed((size_t) numPresets);
+        start = Clock::now();
+        for (int i = 0; i < numPresets; i++)
+            parsed[(size_t) i] = library.parse(*bank, i);
+        const double parseSeconds = secondsSince(start) / numPresets;
+
+        // the bank is sorted by name, the number in the name is the order of creation
+        int numMismatches = 0;
+        for (int i = 0; i < numPresets; i++)
+        {
+            const auto& expected = values[(size_t) bank->getName(i).fromLastOccurrenceOf(" ", false, false).getIntValue()];
+            const auto& preset = parsed[(size_t) i];
+            bool matches = preset != nullptr && preset->values.size() == expected.size();
+
+            for (size_t v = 0; matches && v < expected.size(); v++)
+                matches = std::abs(preset->values[v] - expected[v]) <= 1.0e-5f * juce::jmax(1.0f, std::abs(expected[v]));
+
+            numMismatches += matches ? 0 : 1;
+        }
+        passed = passed && numMismatches == 0;
+
+        std::printf("bank of %d presets, %lld bytes, %d tags\n", numPresets, (long long) file.getSize(), bank->getTagNames().size());
+        std::printf("  write             %10.3f ms\n", writeSeconds * 1.0e3);
+        std::printf("  open              %10.3f ms\n", openSeconds * 1.0e3);
+        std::printf("  find by name      %10.2f us\n", nameSeconds * 1.0e6);
+        std::printf("  find by tag       %10.2f us   (%.0f presets per tag)\n", tagSeconds * 1.0e6, (double) numTagged / numQueries);
+        std::printf("  find similar      %10.2f us\n", similarSeconds * 1.0e6);
+        std::printf("  parse a preset    %10.2f us   (%d mismatches)\n", parseSeconds * 1.0e6, numMismatches);
+        std::printf("  restore binary    %10.2f us   (%d mismatches)\n", binaryRestoreSeconds * 1.0e6, binaryMismatches);
+        std::printf("  restore XML       %10.2f us   (%d mismatches)\n", xmlRestoreSeconds * 1.0e6, xmlMismatches);
+        std::printf("%s\n", passed ? "all presets read back" : "FAILED");
+
+        bank.reset();
+        file.deleteFile();
+        return passed;
+    }
+};
+
+#endif // PRESET_BANK_BENCH_H
@@ -0,0 +1,719 @@
+/*
+  ==============================================================================
+
+    ReferenceSynth.h
+
+    Frozen scalar reference of the synth's DSP path: Phasor, OscSwitch, LFO,
+    Filter and synthVoice as they were before the block, SIMD and control-rate
+    rework, rendering one sample at a time with the exact coefficient formulas.
+    Do not optimise this file, it is what the optimised engine is compared to.
+
+    Two deliberate fixes over the original code, both of which made the original
+    output undefined: voices start silent (playing = false) and there is room for
+    all 7 unison voices of the "8" choice.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef REFERENCE_SYNTH_H
+#define REFERENCE_SYNTH_H
+
+#include <cmath>
+#include <memory>
+#include <variant>
+#include <vector>
+#include <JuceHeader.h>
+
+namespace reference
+{
+
+// PARENT phasor class
+class Phasor {
+public:
+    // update the phase and output the next sample from the oscillator
+    float process() {
+        phase += phaseDelta;
+
+        if (phase > 1.0f)
+            phase -= 1.0f;
+
+        return output(phase);
+
+    }
+
+    virtual ~Phasor() = default;
+
+    virtual float output(float p) {
+        return p;
+    }
+
+    void setSampleRate(float SR)
+    {
+        sampleRate = SR;
+    }
+
+    void setFrequency(float freq)
+    {
+        frequency = freq;
+        phaseDelta = frequency / sampleRate;
+    }
+
+    void setPhase(float ph)
+    {
+        phase = ph;
+    }
+
+    float getPhase()
+    {
+        return phase;
+    }
+
+    void setPhaseOffset(float _phaseOffset)
+    {
+        phaseOffset = _phaseOffset;
+    }
+
+    void setAmplitudeOffset(float _amplitudeOffset)
+    {
+        amplitudeOffset = _amplitudeOffset;
+    }
+
+    void setFreqOffset(float _freqOffset)
+    {
+        freqOffset = _freqOffset;
+    }
+
+private:
+    float frequency;
+    float sampleRate;
+    float phase = 0.0f;
+    float phaseDelta;
+    float amplitude = 1.0f;   // amplitude
+    // modulation parameters
+    float freqOffset = 0.0f;
+    float phaseOffset = 0.0f;     // phase offset
+    float amplitudeOffset = 0.0f; // amplitude offset
+};
+
+class TriOsc : public Phasor
+{
+    float output(float p) override
+    {
+        return fabsf(p - 0.5f) - 0.5f;
+    }
+};
+
+class SinOsc : public Phasor
+{
+    float output(float p) override
+    {
+        return std::sin(p * 2.0 * 3.14159);
+    }
+};
+
+class SawOsc : public Phasor
+{
+    float output(float p) override
+    {
+        return p / juce::MathConstants<float>::pi;
+    }
+};
+
+class SqrOsc : public Phasor
+{
+public:
+    float output(float p) override
+    {
+        float outVal = 0.5;
+        if (p > pulseWidth)
+            outVal = -0.5;
+        return outVal;
+    }
+    float pulseWidth = 0.5f;
+};
+
+//==============================================================================
+class OscSwitch
+{
+public:
+    using OscVariant = std::variant<SinOsc, TriOsc, SawOsc, SqrOsc>;
+
+    OscSwitch() : osc(SinOsc{}) {}
+
+    float process()
+    {
+        float freq = freqbase + freqOffset;
+        setFrequency(freq);
+        resetModulations();
+        return std::visit([](auto& os) { return os.process(); }, osc);
+    }
+
+    void setSampleRate(float _sampleRate)
+    {
+        jassert(_sampleRate > 0.0f);
+        sampleRate = _sampleRate;
+        std::visit([_sampleRate](auto& os) { os.setSampleRate(_sampleRate); }, osc);
+    }
+
+    void setWaveshape(int _waveshapeId)
+    {
+        switch (_waveshapeId)
+        {
+        case 0:
+            osc.emplace<SinOsc>();
+            break;
+        case 1:
+            osc.emplace<TriOsc>();
+            break;
+        case 2:
+            osc.emplace<SawOsc>();
+            break;
+        case 3:
+            osc.emplace<SqrOsc>();
+            break;
+        default:
+            osc.emplace<SinOsc>();
+        }
+
+        std::visit([this](auto& os) { os.setSampleRate(sampleRate); os.setFrequency(frequency); os.setPhase(phase); }, osc);
+    }
+
+    void setFrequency(float _frequency)
+    {
+        frequency = _frequency;
+        std::visit([_frequency](auto& os) { os.setFrequency(_frequency); }, osc);
+    }
+
+    void setFreqBase(float _frequency)
+    {
+        freqbase = _frequency;
+    }
+
+    void setFreqOffset(float _freqOffset)
+    {
+        freqOffset += _freqOffset;
+        std::visit([_freqOffset](auto& os) { os.setFreqOffset(_freqOffset); }, osc);
+    }
+
+    void setPhaseOffset(float _phaseOffset)
+    {
+        phaseOffset += _phaseOffset;
+        std::visit([_phaseOffset](auto& os) { os.setPhaseOffset(_phaseOffset); }, osc);
+    }
+
+    void setAmplitudeOffset(float _amplitudeOffset)
+    {
+        amplitudeOffset += _amplitudeOffset;
+        std::visit([_amplitudeOffset](auto& os) { os.setAmplitudeOffset(_amplitudeOffset); }, osc);
+    }
+
+    void startNote(float _sampleRate, int _OscWaveshape, int _OscFreq)
+    {
+        (*this).setSampleRate(_sampleRate);
+        (*this).setWaveshape(_OscWaveshape);
+        (*this).setFrequency(_OscFreq);
+        (*this).setFreqBase(_OscFreq);
+    }
+
+    void resetModulations()
+    {
+        amplitudeOffset = 0.0f;
+        setAmplitudeOffset(0.0f);
+        freqOffset = 0.0f;
+        setFreqOffset(0.0f);
+        phaseOffset = 0.0f;
+        setPhaseOffset(0.0f);
+    }
+
+private:
+    OscVariant osc;
+
+    float sampleRate = 0.0f;
+    float frequency = 0.0f;
+    float freqbase = 0.0f;
+    float phase = 0.0f;
+    float phaseOffset = 0.0f;
+    float freqOffset = 0.0f;
+    float amplitudeOffset = 0.0f;
+};
+
+//==============================================================================
+class LFO
+{
+public:
+    using OscVariant = std::variant<SinOsc, TriOsc, SawOsc, SqrOsc>;
+
+    LFO() : lfo(SinOsc{}) {}
+
+    float process()
+    {
+        // FM
+        float freq = frequency + frequencyOffset;
+        std::visit([freq](auto& os) { os.setFrequency(freq); }, lfo);
+
+        float lfoSample = (std::visit([](auto& os) { return os.process(); }, lfo));
+        lfoSample = amount * lfoSample;
+        smoothedLFOValue.setTargetValue(lfoSample);
+        return smoothedLFOValue.getNextValue();
+    }
+
+    void setSampleRate(float _sampleRate)
+    {
+        std::visit([_sampleRate](auto& os) { os.setSampleRate(_sampleRate); }, lfo);
+        sampleRate = _sampleRate;
+        smoothedLFOValue.reset(_sampleRate, 0.01);
+    }
+
+    void setWaveshape(int _waveshapeId)
+    {
+        switch (_waveshapeId)
+        {
+        case 0:
+            lfo.emplace<SinOsc>();
+            break;
+        case 1:
+            lfo.emplace<TriOsc>();
+            break;
+        case 2:
+            lfo.emplace<SawOsc>();
+            break;
+        case 3:
+            lfo.emplace<SqrOsc>();
+            break;
+        default:
+            lfo.emplace<SinOsc>();
+        }
+
+        std::visit([this](auto& os) { os.setSampleRate(sampleRate); os.setFrequency(frequency); os.setPhase(phase); }, lfo);
+    }
+
+    void setFrequency(float _frequency)
+    {
+        frequency = _frequency;
+        std::visit([_frequency](auto& os) { os.setFrequency(_frequency); }, lfo);
+    }
+
+    void setAmount(float _amount)
+    {
+        amount = _amount;
+    }
+
+    void startNote(float _sampleRate, int _LFOWaveshape, float _LFOFreq, float _LFOAmount)
+    {
+        (*this).setSampleRate(_sampleRate);
+        (*this).setWaveshape(_LFOWaveshape);
+        (*this).setFrequency(_LFOFreq);
+        (*this).setAmount(_LFOAmount);
+        smoothedLFOValue.setCurrentAndTargetValue(0.0f);
+    }
+
+    bool isAppliedToOsc1AM(int lfoDestination) { return lfoDestination == 0; }
+    bool isAppliedToOsc2AM(int lfoDestination) { return lfoDestination == 1; }
+    bool isAppliedToOsc1FM(int lfoDestination) { return lfoDestination == 2; }
+    bool isAppliedToOsc2FM(int lfoDestination) { return lfoDestination == 3; }
+    bool isAppliedToOsc1PM(int lfoDestination) { return lfoDestination == 4; }
+    bool isAppliedToOsc2PM(int lfoDestination) { return lfoDestination == 5; }
+    bool isAppliedToFilterCutoffFreq(int lfoDestination) { return lfoDestination == 6; }
+
+private:
+    OscVariant lfo;
+    juce::SmoothedValue<float> smoothedLFOValue;
+    float sampleRate = 0.0f;
+    float frequency = 0.0f;
+    float phase = 0.0f;
+    float amount = 0.0f;
+    float frequencyOffset = 0.0f;
+};
+
+//==============================================================================
+class Filter
+{
+public:
+    /// new coefficients from the exact formulas on every sample
+    float process(float _inSample, int _filterType)
+    {
+        float freq = cutoffbase + frequencyOffset;
+
+        (*this).setFrequency(freq);
+        (*this).makeFilter(_filterType);
+
+        resetModulations();
+        return filter.processSingleSampleRaw(_inSample);
+    }
+
+    void setSampleRate(float _sampleRate)
+    {
+        jassert(_sampleRate > 0.0f);
+        sampleRate = _sampleRate;
+    }
+
+    void setCutoffBase(float _frequency)
+    {
+        cutoffbase = _frequency;
+    }
+
+    void setFrequency(float _frequency)
+    {
+        cutoff = _frequency;
+    }
+
+    void setResonance(float _resonance)
+    {
+        Q = _resonance;
+    }
+
+    void makeFilter(int _filterType)
+    {
+        switch (_filterType)
+        {
+        case 0:
+            filter.setCoefficients(juce::IIRCoefficients::makeLowPass(sampleRate, cutoff, Q));
+            break;
+        case 1:
+            filter.setCoefficients(juce::IIRCoefficients::makeHighPass(sampleRate, cutoff, Q));
+            break;
+        case 2:
+            filter.setCoefficients(juce::IIRCoefficients::makeBandPass(sampleRate, cutoff, Q));
+            break;
+        }
+    }
+
+    void setFrequencyOffset(float _frequencyOffset)
+    {
+        frequencyOffset += _frequencyOffset;
+    }
+
+    void resetModulations()
+    {
+        frequencyOffset = 0.0f;
+    }
+
+    void startNote(float _sampleRate, float _frequency, float _resonance, int _filterType)
+    {
+        filter.reset();
+
+        (*this).setSampleRate(_sampleRate);
+        (*this).setFrequency(_frequency);
+        (*this).setCutoffBase(_frequency);
+        (*this).setResonance(_resonance);
+        (*this).makeFilter(_filterType);
+    }
+
+private:
+    float sampleRate = 0.0f;
+    juce::IIRFilter filter;
+    float cutoff = 0.0f, cutoffbase = 0.0f;
+    float Q = 0.0f;
+    float frequencyOffset = 0.0f;
+};
+
+//==============================================================================
+/// Parameter values copied from the processor under test, handed to the voices as the APVTS atomics were.
+class ParameterMirror
+{
+public:
+    explicit ParameterMirror(const juce::AudioProcessor& processor)
+    {
+        for (auto* parameter : processor.getParameters())
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+                values.push_back({ ranged->getParameterID(), std::make_unique<std::atomic<float>>(ranged->convertFrom0to1(ranged->getValue())) });
+    }
+
+    std::atomic<float>* getRawParameterValue(const juce::String& id) const
+    {
+        for (auto& value : values)
+            if (value.first == id)
+                return value.second.get();
+
+        jassertfalse;
+        return nullptr;
+    }
+
+private:
+    std::vector<std::pair<juce::String, std::unique_ptr<std::atomic<float>>>> values;
+};
+
+//==============================================================================
+class Sound : public juce::SynthesiserSound
+{
+public:
+    bool appliesToNote(int) override { return true; }
+    bool appliesToChannel(int) override { return true; }
+};
+
+class Voice : public juce::SynthesiserVoice
+{
+public:
+    void setParametersFromApvts(const ParameterMirror& apvts)
+    {
+        attackParam[0] = apvts.getRawParameterValue("attack1");
+        decayParam[0] = apvts.getRawParameterValue("decay1");
+        sustainParam[0] = apvts.getRawParameterValue("sustain1");
+        releaseParam[0] = apvts.getRawParameterValue("release1");
+
+        attackParam[1] = apvts.getRawParameterValue("attack2");
+        decayParam[1] = apvts.getRawParameterValue("decay2");
+        sustainParam[1] = apvts.getRawParameterValue("sustain2");
+        releaseParam[1] = apvts.getRawParameterValue("release2");
+
+        OscWaveshapeParam[0] = apvts.getRawParameterValue("Osc1Waveshape");
+        OscWaveshapeParam[1] = apvts.getRawParameterValue("Osc2Waveshape");
+
+        UnisonParam[0] = apvts.getRawParameterValue("Osc1Unison");
+        UnisonParam[1] = apvts.getRawParameterValue("Osc2Unison");
+        DetuneParam[0] = apvts.getRawParameterValue("Osc1Detune");
+        DetuneParam[1] = apvts.getRawParameterValue("Osc2Detune");
+
+        Level[0] = apvts.getRawParameterValue("level1");
+        Level[1] = apvts.getRawParameterValue("level2");
+
+        filterOn = apvts.getRawParameterValue("FilterOn");
+        filterType = apvts.getRawParameterValue("filterType");
+        cutoffParam = apvts.getRawParameterValue("cutOff");
+        QParam = apvts.getRawParameterValue("Q");
+
+        lfoDestinationParam[0] = apvts.getRawParameterValue("LFO1Destination");
+        lfoWaveshapeParam[0] = apvts.getRawParameterValue("LFO1Waveshape");
+        lfoFreqParam[0] = apvts.getRawParameterValue("LFO1FreqParam");
+        lfoAmountParam[0] = apvts.getRawParameterValue("LFO1AmountParam");
+
+        lfoDestinationParam[1] = apvts.getRawParameterValue("LFO2Destination");
+        lfoWaveshapeParam[1] = apvts.getRawParameterValue("LFO2Waveshape");
+        lfoFreqParam[1] = apvts.getRawParameterValue("LFO2FreqParam");
+        lfoAmountParam[1] = apvts.getRawParameterValue("LFO2AmountParam");
+    }
+
+    void startNote(int midiNoteNumber, float, juce::SynthesiserSound*, int) override
+    {
+        playing = true;
+        float freq = juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber);
+
+        Osc1.startNote(getSampleRate(), *OscWaveshapeParam[0], freq);
+        Osc2.startNote(getSampleRate(), *OscWaveshapeParam[1], freq);
+
+        for (int i = 1; i < *UnisonParam[0] + 1; i++)
+            Uni1[i].startNote(getSampleRate(), *OscWaveshapeParam[0], freq + 0.1 * (*DetuneParam[0]) * i);
+
+        for (int i = 1; i < *UnisonParam[1] + 1; i++)
+            Uni2[i].startNote(getSampleRate(), *OscWaveshapeParam[1], freq + 0.1 * (*DetuneParam[1]) * i);
+
+        env1.setSampleRate(getSampleRate());
+        env2.setSampleRate(getSampleRate());
+
+        juce::ADSR::Parameters envPara1, envPara2;
+        envPara1.attack = *attackParam[0];
+        envPara1.decay = *decayParam[0];
+        envPara1.sustain = *sustainParam[0];
+        envPara1.release = *releaseParam[0];
+
+        envPara2.attack = *attackParam[1];
+        envPara2.decay = *decayParam[1];
+        envPara2.sustain = *sustainParam[1];
+        envPara2.release = *releaseParam[1];
+
+        env1.setParameters(envPara1);
+        env1.noteOn();
+
+        env2.setParameters(envPara2);
+        env2.noteOn();
+
+        filter.startNote(getSampleRate(), *cutoffParam, *QParam, *filterType);
+
+        lfo1.startNote(getSampleRate(), *lfoWaveshapeParam[0], *lfoFreqParam[0], *lfoAmountParam[0]);
+        lfo2.startNote(getSampleRate(), *lfoWaveshapeParam[1], *lfoFreqParam[1], *lfoAmountParam[1]);
+    }
+
+    void stopNote(float, bool) override
+    {
+        env1.noteOff();
+        env2.noteOff();
+    }
+
+    void renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override
+    {
+        if (!playing)
+            return;
+
+        for (int i = startSample; i < startSample + numSamples; i++)
+        {
+            UniSample1 = 0;
+            UniSample2 = 0;
+
+            for (int v = 1; v < *UnisonParam[0] + 1; v++)
+                UniSample1 += Uni1[v].process();
+
+            for (int v = 1; v < *UnisonParam[1] + 1; v++)
+                UniSample2 += Uni2[v].process();
+
+            int lfo1Destination = *lfoDestinationParam[0];
+            int lfo2Destination = *lfoDestinationParam[1];
+
+            float lfo1Sample = lfo1.process();
+            float lfo2Sample = lfo2.process();
+
+            if (lfo1.isAppliedToOsc1AM(lfo1Destination))
+                Osc1.setAmplitudeOffset(lfo1Sample);
+            if (lfo2.isAppliedToOsc1AM(lfo2Destination))
+                Osc1.setAmplitudeOffset(lfo2Sample);
+            if (lfo1.isAppliedToOsc2AM(lfo1Destination))
+                Osc2.setAmplitudeOffset(lfo1Sample);
+            if (lfo2.isAppliedToOsc2AM(lfo2Destination))
+                Osc2.setAmplitudeOffset(lfo2Sample);
+
+            if (lfo1.isAppliedToOsc1FM(lfo1Destination))
+                Osc1.setFreqOffset(5 * lfo1Sample);
+            if (lfo2.isAppliedToOsc1FM(lfo2Destination))
+                Osc1.setFreqOffset(5 * lfo2Sample);
+            if (lfo1.isAppliedToOsc2FM(lfo1Destination))
+                Osc2.setFreqOffset(5 * lfo1Sample);
+            if (lfo2.isAppliedToOsc2FM(lfo2Destination))
+                Osc2.setFreqOffset(5 * lfo2Sample);
+
+            if (lfo1.isAppliedToOsc1PM(lfo1Destination))
+                Osc1.setAmplitudeOffset(lfo1Sample);
+            if (lfo2.isAppliedToOsc1PM(lfo2Destination))
+                Osc1.setAmplitudeOffset(lfo2Sample);
+            if (lfo1.isAppliedToOsc2PM(lfo1Destination))
+                Osc2.setAmplitudeOffset(lfo1Sample);
+            if (lfo2.isAppliedToOsc2PM(lfo2Destination))
+                Osc2.setAmplitudeOffset(lfo2Sample);
+
+            if (lfo1.isAppliedToFilterCutoffFreq(lfo1Destination))
+                filter.setFrequencyOffset(7 * lfo1Sample);
+            if (lfo2.isAppliedToFilterCutoffFreq(lfo2Destination))
+                filter.setFrequencyOffset(7 * lfo2Sample);
+
+            float outputSample1 = (Osc1.process() + UniSample1) / (*UnisonParam[0] + 1);
+            float outputSample2 = (Osc2.process() + UniSample2) / (*UnisonParam[1] + 1);
+
+            float Osc1level = *Level[0];
+            float Osc2level = *Level[1];
+
+            float envvalue1 = env1.getNextSample();
+            float envvalue2 = env2.getNextSample();
+
+            float outputSample = envvalue1 * Osc1level * outputSample1 + envvalue2 * Osc2level * outputSample2;
+
+            if (*filterOn == true)
+                outputSample = filter.process(outputSample, *filterType);
+
+            for (int chan = 0; chan < outputBuffer.getNumChannels(); chan++)
+                outputBuffer.addSample(chan, i, outputSample * 0.1);
+
+            if (!env1.isActive() && !env2.isActive())
+            {
+                playing = false;
+                clearCurrentNote();
+            }
+        }
+    }
+
+    bool canPlaySound(juce::SynthesiserSound*) override { return true; }
+    void pitchWheelMoved(int) override {}
+    void controllerMoved(int, int) override {}
+
+private:
+    bool playing = false;
+    Filter filter;
+    LFO lfo1, lfo2;
+    OscSwitch Osc1, Osc2;
+    OscSwitch Uni1[8], Uni2[8];           // indices 1-7 are used
+
+    float UniSample1 = 0.0f, UniSample2 = 0.0f;
+    juce::ADSR env1, env2;
+
+    std::atomic<float>* attackParam[2];
+    std::atomic<float>* decayParam[2];
+    std::atomic<float>* sustainParam[2];
+    std::atomic<float>* releaseParam[2];
+
+    std::atomic<float>* OscWaveshapeParam[2];
+    std::atomic<float>* Level[2];
+    std::atomic<float>* UnisonParam[2];
+    std::atomic<float>* DetuneParam[2];
+
+    std::atomic<float>* filterOn;
+    std::atomic<float>* filterType;
+    std::atomic<float>* cutoffParam;
+    std::atomic<float>* QParam;
+
+    std::atomic<float>* lfoDestinationParam[2];
+    std::atomic<float>* lfoWaveshapeParam[2];
+    std::atomic<float>* lfoFreqParam[2];
+    std::atomic<float>* lfoAmountParam[2];
+};
+
+//==============================================================================
+/// The original processBlock: a plain juce::Synthesiser followed by juce::Reverb,
+/// with the parameter values of the processor under test.
+class ReferenceProcessor : public juce::AudioProcessor
+{
+public:
+    explicit ReferenceProcessor(const juce::AudioProcessor& parametersFrom)
+        : AudioProcessor(BusesProperties().withOutput("Output", juce::AudioChannelSet::stereo(), true)),
+          parameters(parametersFrom)
+    {
+        reverbon = parameters.getRawParameterValue("Reverb");
+        const int numVoices = (int) parameters.getRawParameterValue("Polyphony")->load();
+
+        synth.addSound(new Sound());
+        for (int i = 0; i < numVoices; i++)
+        {
+            auto* voice = new Voice();
+            voice->setParametersFromApvts(parameters);
+            synth.addVoice(voice);
+        }
+    }
+
+    void prepareToPlay(double sampleRate, int) override
+    {
+        synth.setCurrentPlaybackSampleRate(sampleRate);
+
+        juce::Reverb::Parameters reverbParams;
+        reverbParams.dryLevel = 0.5f;
+        reverbParams.wetLevel = 0.5f;
+        reverbParams.roomSize = 0.5f;
+
+        reverb.setParameters(reverbParams);
+        reverb.reset();
+    }
+
+    void releaseResources() override {}
+
+    void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
+    {
+        juce::ScopedNoDenormals noDenormals;
+        buffer.clear();
+
+        synth.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
+
+        if (*reverbon == true)
+            reverb.processStereo(buffer.getWritePointer(0), buffer.getWritePointer(1), buffer.getNumSamples());
+    }
+
+    juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+    bool hasEditor() const override { return false; }
+    const juce::String getName() const override { return "Reference"; }
+    bool acceptsMidi() const override { return true; }
+    bool producesMidi() const override { return false; }
+    double getTailLengthSeconds() const override { return 0.0; }
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int) override {}
+    const juce::String getProgramName(int) override { return {}; }
+    void changeProgramName(int, const juce::String&) override {}
+    void getStateInformation(juce::MemoryBlock&) override {}
+    void setStateInformation(const void*, int) override {}
+
+private:
+    ParameterMirror parameters;
+    juce::Synthesiser synth;
+    juce::Reverb reverb;
+    std::atomic<float>* reverbon;
+};
+
+} // namespace reference
+
+#endif // REFERENCE_SYNTH_H
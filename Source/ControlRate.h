@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    ControlRate.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef CONTROL_RATE_H
+#define CONTROL_RATE_H
+
+#include <JuceHeader.h>
+
+/// Control-rate settings: modulation sources are evaluated once every N samples
+/// instead of on every sample. The interval is chosen with the "ModulationRate" parameter.
+struct ControlRate
+{
+    /// choices shown for the "ModulationRate" parameter, "Per Sample" keeps the reference path
+    static juce::StringArray getChoices()
+    {
+        return { "Per Sample", "16 Samples", "32 Samples", "64 Samples" };
+    }
+
+    /// convert the "ModulationRate" choice index to an update interval in samples
+    /// @param int, choice index
+    /// @return int, samples between two modulation updates
+    static int getInterval(int _choice)
+    {
+        switch (_choice)
+        {
+        case 1:
+            return 16;
+        case 2:
+            return 32;
+        case 3:
+            return 64;
+        default:
+            return 1;
+        }
+    }
+};
+
+/// Linear ramp that spreads a control-rate modulation value over the samples until the next update,
+/// so audio-rate consumers see a smooth value instead of a staircase.
+class ControlRateRamp
+{
+public:
+    /// set the value to reach after numSamples calls to getNextValue()
+    /// @param float, target value
+    /// @param int, ramp length in samples, 1 jumps straight to the target
+    void setTarget(float _target, int _numSamples)
+    {
+        if (_numSamples <= 1)
+        {
+            value = _target;
+            step = 0.0f;
+        }
+        else
+        {
+            step = (_target - value) / _numSamples;
+        }
+    }
+
+    float getNextValue()
+    {
+        value += step;
+        return value;
+    }
+
+    /// advance by several samples at once
+    /// @param int, number of samples
+    /// @return float, value after the last of them
+    float skip(int _numSamples)
+    {
+        value += step * (float) _numSamples;
+        return value;
+    }
+
+    void reset(float _value = 0.0f)
+    {
+        value = _value;
+        step = 0.0f;
+    }
+
+private:
+    float value = 0.0f;
+    float step = 0.0f;
+};
+
+#endif // CONTROL_RATE_H
@@ -0,0 +1,462 @@
+/*
+  ==============================================================================
+
+    ConvolutionReverb.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef CONVOLUTION_REVERB_H
+#define CONVOLUTION_REVERB_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <JuceHeader.h>
+#include "ImpulseResponse.h"
+#include "SpinWait.h"
+
+/// Zero-latency convolution of the mono sum of the input with a stereo impulse response, using
+/// non-uniform partitioned convolution:
+///   - the direct taps are convolved per sample,
+///   - the head partitions with a uniformly partitioned overlap-save FFT every headSize samples on the audio thread,
+///   - the tail partitions with an FFT every tailSize samples on a realtime worker thread. The tail starts two
+///     partitions into the response, so the worker has a whole partition period to compute each block before
+///     its output is due; the audio thread only waits if the worker missed that deadline.
+/// Impulse responses are loaded on a background thread and swapped in at the start of a block.
+/// The response is played at its recorded sample rate, it is not resampled to the host rate.
+class ConvolutionReverb
+{
+public:
+    static constexpr float dryLevel = 1.0f;
+    static constexpr float wetLevel = 0.5f;
+
+    ~ConvolutionReverb()
+    {
+        loader.removeAllJobs(true, 10000);
+        release();
+    }
+
+    /// stop the tail worker and clear the convolution state (prepareToPlay)
+    /// @param int, maximum block size, used for the realtime thread scheduling hints
+    /// @param double, sample rate
+    void prepare(int _maxBlockSize, double _sampleRate)
+    {
+        release();
+
+        maxBlockSize = _maxBlockSize;
+        sampleRate = _sampleRate;
+
+        if (active != nullptr)
+            active->reset();
+    }
+
+    /// start the tail worker if it is not running yet (message thread, or prepareToPlay), once the
+    /// convolution is selected; it runs until release(), the tail is computed inline until then
+    void start()
+    {
+        if (started.load(std::memory_order_acquire))
+            return;
+
+        // on a single core the tail is computed inline, a worker would only compete with the audio thread
+        if (juce::SystemStats::getNumCpus() > 1)
+        {
+            worker = std::make_unique<Worker>(*this);
+            worker->startRealtimeThread(juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime(maxBlockSize, sampleRate));
+        }
+
+        // the audio thread reads the worker only after this
+        started.store(true, std::memory_order_release);
+    }
+
+    /// true once start() has run
+    bool isStarted() const
+    {
+        return started.load(std::memory_order_acquire);
+    }
+
+    /// stop the tail worker (releaseResources)
+    void release()
+    {
+        started.store(false, std::memory_order_release);
+
+        if (worker != nullptr)
+        {
+            worker->signalThreadShouldExit();
+            wakeCounter.fetch_add(1, std::memory_order_release);
+            wakeCounter.notify_all();
+            worker->stopThread(1000);
+            worker.reset();
+        }
+
+        // a job the worker did not pick up before it stopped
+        if (jobPending.load(std::memory_order_acquire))
+        {
+            jobEngine->runTailJob(jobSlot);
+            jobPending.store(false, std::memory_order_release);
+        }
+
+        std::unique_ptr<Engine> garbage;
+        const juce::SpinLock::ScopedLockType lock(engineLock);
+        garbage = std::move(retired);
+    }
+
+    /// load an impulse response on the background thread, the current one plays until it is ready
+    /// @param juce::File, impulse response file (WAV or AIFF)
+    void loadImpulseResponse(const juce::File& _file)
+    {
+        impulseResponseFile = _file;
+        numLoading++;
+
+        loader.addJob([this, _file]
+        {
+            auto ir = cache->get(_file);
+            auto engine = ir != nullptr ? std::make_unique<Engine>(ir) : nullptr;
+
+            // engines are freed here, never on the audio thread
+            std::unique_ptr<Engine> garbage[2];
+            {
+                const juce::SpinLock::ScopedLockType lock(engineLock);
+                garbage[0] = std::move(retired);
+
+                if (engine != nullptr)
+                {
+                    garbage[1] = std::move(pending);
+                    pending = std::move(engine);
+                    hasPending.store(true, std::memory_order_release);
+                    tailSamples.store(ir->getLength() + 4 * ImpulseResponse::tailSize, std::memory_order_relaxed);
+                    ready.store(true, std::memory_order_release);
+                }
+            }
+
+            numLoading--;
+        });
+    }
+
+    /// the last file passed to loadImpulseResponse
+    const juce::File& getImpulseResponseFile() const { return impulseResponseFile; }
+
+    /// true while an impulse response is being loaded
+    bool isLoading() const { return numLoading.load() > 0; }
+
+    /// true once an impulse response has been loaded
+    bool isReady() const { return ready.load(std::memory_order_acquire); }
+
+    /// samples of silent input after which the output and the whole convolution state are zero
+    int getTailSamples() const { return tailSamples.load(std::memory_order_relaxed); }
+
+    /// convolve a block in place, dry + wet
+    /// @param float*, left channel
+    /// @param float*, right channel
+    /// @param int, number of samples
+    void processStereo(float* _left, float* _right, int _numSamples)
+    {
+        adoptPendingEngine();
+
+        if (active == nullptr)
+            return;
+
+        auto& engine = *active;
+        const float* direct[2] = { engine.ir->getDirect(0), engine.ir->getDirect(1) };
+
+        // chunks end on head partition boundaries, which are also tail partition boundaries
+        for (int done = 0; done < _numSamples;)
+        {
+            const int numSamples = juce::jmin(_numSamples - done, ImpulseResponse::headSize - engine.headFill);
+            float* left = _left + done;
+            float* right = _right + done;
+
+            float* input = engine.headInput.data() + ImpulseResponse::headSize + engine.headFill;
+            for (int i = 0; i < numSamples; i++)
+                input[i] = 0.5f * (left[i] + right[i]);
+
+            std::copy(input, input + numSamples, engine.tailStage.data() + engine.tailFill);
+
+            const int readSlot = engine.tailPeriod & 1;
+            const float* head[2] = { engine.headOutput[0].data() + engine.headFill, engine.headOutput[1].data() + engine.headFill };
+            const float* tail[2] = { engine.tailOutput[readSlot][0].data() + engine.tailFill, engine.tailOutput[readSlot][1].data() + engine.tailFill };
+
+            for (int i = 0; i < numSamples; i++)
+            {
+                float wet[2] = { head[0][i] + tail[0][i], head[1][i] + tail[1][i] };
+
+                // the head input holds the previous head block, which covers the history of the direct taps
+                const float* x = input + i;
+                for (int k = 0; k < ImpulseResponse::directLength; k++)
+                {
+                    wet[0] += direct[0][k] * x[-k];
+                    wet[1] += direct[1][k] * x[-k];
+                }
+
+                left[i] = dryLevel * left[i] + wetLevel * wet[0];
+                right[i] = dryLevel * right[i] + wetLevel * wet[1];
+            }
+
+            engine.headFill += numSamples;
+            engine.tailFill += numSamples;
+            done += numSamples;
+
+            if (engine.headFill == ImpulseResponse::headSize)
+                engine.processHeadBlock();
+
+            if (engine.tailFill == ImpulseResponse::tailSize)
+                postTailJob(engine);
+        }
+    }
+
+private:
+    /// convolution state for one impulse response, built on the loader thread
+    struct Engine
+    {
+        explicit Engine(ImpulseResponse::Ptr _ir)
+            : ir(_ir), headFft(ImpulseResponse::headOrder), tailFft(ImpulseResponse::tailOrder)
+        {
+            const auto& headPartitions = ir->getHead();
+            const auto& tailPartitions = ir->getTail();
+
+            headInput.resize(2 * ImpulseResponse::headSize);
+            headSpectra.resize((size_t) (juce::jmax(1, headPartitions.numPartitions) * headPartitions.getSpectrumSize()));
+            headBuffer.resize(4 * ImpulseResponse::headSize);
+            headAccumulator.resize((size_t) headPartitions.getSpectrumSize());
+
+            tailStage.resize(ImpulseResponse::tailSize);
+            jobInput.resize(2 * ImpulseResponse::tailSize);
+            tailSpectra.resize((size_t) (juce::jmax(1, tailPartitions.numPartitions) * tailPartitions.getSpectrumSize()));
+            tailBuffer.resize(4 * ImpulseResponse::tailSize);
+            tailAccumulator.resize((size_t) tailPartitions.getSpectrumSize());
+
+            for (int channel = 0; channel < 2; channel++)
+            {
+                headOutput[channel].resize(ImpulseResponse::headSize);
+                tailOutput[0][channel].resize(ImpulseResponse::tailSize);
+                tailOutput[1][channel].resize(ImpulseResponse::tailSize);
+            }
+        }
+
+        void reset()
+        {
+            for (auto* buffer : { &headInput, &headSpectra, &tailStage, &jobInput, &tailSpectra,
+                                  &headOutput[0], &headOutput[1], &tailOutput[0][0], &tailOutput[0][1], &tailOutput[1][0], &tailOutput[1][1] })
+                std::fill(buffer->begin(), buffer->end(), 0.0f);
+
+            headFill = headSlot = 0;
+            tailFill = tailSlot = tailPeriod = 0;
+        }
+
+        /// convolve the completed head block with the head partitions, the result plays during the next block
+        void processHeadBlock()
+        {
+            headFill = 0;
+            const auto& partitions = ir->getHead();
+            if (partitions.numPartitions == 0)
+            {
+                // the current block is still the history of the direct taps
+                std::copy(headInput.begin() + ImpulseResponse::headSize, headInput.end(), headInput.begin());
+                return;
+            }
+
+            headSlot = transformBlock(headFft, headInput, headBuffer, headSpectra, headSlot, partitions);
+            accumulate(headFft, headBuffer, headAccumulator, headSpectra, headSlot, partitions, headOutput);
+        }
+
+        /// convolve the completed tail block with the tail partitions, the result plays one tail block later
+        /// @param int, output slot
+        void runTailJob(int _slot)
+        {
+            const auto& partitions = ir->getTail();
+
+            tailSlot = transformBlock(tailFft, jobInput, tailBuffer, tailSpectra, tailSlot, partitions);
+            accumulate(tailFft, tailBuffer, tailAccumulator, tailSpectra, tailSlot, partitions, tailOutput[_slot]);
+        }
+
+        /// overlap-save: transform the previous and the current block into the frequency-domain delay line,
+        /// then shift the current block to the front
+        /// @return int, delay line slot of the new spectrum
+        static int transformBlock(const juce::dsp::FFT& _fft, std::vector<float>& _input, std::vector<float>& _buffer,
+                                  std::vector<float>& _spectra, int _slot, const ImpulseResponse::Partitions& _partitions)
+        {
+            const int size = _partitions.size;
+            const int spectrumSize = _partitions.getSpectrumSize();
+            const int slot = (_slot + 1) % _partitions.numPartitions;
+
+            std::copy(_input.begin(), _input.end(), _buffer.begin());
+            std::fill(_buffer.begin() + 2 * size, _buffer.end(), 0.0f);
+            _fft.performRealOnlyForwardTransform(_buffer.data(), true);
+            ImpulseResponse::splitSpectrum(_buffer.data(), _spectra.data() + slot * spectrumSize, _partitions.getNumBins());
+
+            std::copy(_input.begin() + size, _input.end(), _input.begin());
+            return slot;
+        }
+
+        /// multiply the delay line with the partitions, the last half of the inverse is the output block
+        static void accumulate(const juce::dsp::FFT& _fft, std::vector<float>& _buffer, std::vector<float>& _accumulator,
+                               const std::vector<float>& _spectra, int _slot, const ImpulseResponse::Partitions& _partitions,
+                               std::vector<float>* _output)
+        {
+            const int size = _partitions.size;
+            const int spectrumSize = _partitions.getSpectrumSize();
+
+            for (int channel = 0; channel < 2; channel++)
+            {
+                std::fill(_accumulator.begin(), _accumulator.end(), 0.0f);
+
+                for (int p = 0; p < _partitions.numPartitions; p++)
+                {
+                    const int slot = (_slot - p + _partitions.numPartitions) % _partitions.numPartitions;
+                    multiplyAccumulate(_accumulator.data(), _spectra.data() + slot * spectrumSize,
+                                       _partitions.getSpectrum(channel, p), _partitions.getNumBins());
+                }
+
+                ImpulseResponse::interleaveSpectrum(_accumulator.data(), _buffer.data(), _partitions.getNumBins());
+                _fft.performRealOnlyInverseTransform(_buffer.data());
+                std::copy(_buffer.begin() + size, _buffer.begin() + 2 * size, _output[channel].begin());
+            }
+        }
+
+        /// complex multiply-add of split spectra
+        static void multiplyAccumulate(float* __restrict _accumulator, const float* __restrict _a, const float* __restrict _b, int _numBins)
+        {
+            float* __restrict accumulatorIm = _accumulator + _numBins;
+            const float* __restrict aIm = _a + _numBins;
+            const float* __restrict bIm = _b + _numBins;
+
+            for (int k = 0; k < _numBins; k++)
+            {
+                _accumulator[k] += _a[k] * _b[k] - aIm[k] * bIm[k];
+                accumulatorIm[k] += _a[k] * bIm[k] + aIm[k] * _b[k];
+            }
+        }
+
+        ImpulseResponse::Ptr ir;
+
+        // audio thread: direct taps and head partitions
+        std::vector<float> headInput;                // previous and current head block
+        std::vector<float> headSpectra;              // frequency-domain delay line
+        std::vector<float> headBuffer, headAccumulator;
+        std::vector<float> headOutput[2];
+        juce::dsp::FFT headFft;
+        int headFill = 0;
+        int headSlot = 0;
+
+        // audio thread: tail input and output
+        std::vector<float> tailStage;                // tail block being collected
+        std::vector<float> tailOutput[2][2];         // [slot][channel], written by the tail job, read one block later
+        int tailFill = 0;
+        int tailPeriod = 0;                          // tail blocks completed
+
+        // worker: tail partitions
+        std::vector<float> jobInput;                 // previous and current tail block
+        std::vector<float> tailSpectra;
+        std::vector<float> tailBuffer, tailAccumulator;
+        juce::dsp::FFT tailFft;
+        int tailSlot = 0;
+    };
+
+    class Worker : public juce::Thread
+    {
+    public:
+        explicit Worker(ConvolutionReverb& _owner) : juce::Thread("Convolution Tail"), owner(_owner) {}
+
+        void run() override
+        {
+            for (;;)
+            {
+                // read the counter before looking for a job, a job posted after the look changes the counter
+                const uint32_t seen = owner.wakeCounter.load(std::memory_order_acquire);
+
+                if (threadShouldExit())
+                    break;
+
+                if (owner.jobPending.load(std::memory_order_acquire))
+                {
+                    owner.jobEngine->runTailJob(owner.jobSlot);
+                    owner.jobPending.store(false, std::memory_order_release);
+                }
+
+                owner.wakeCounter.wait(seen, std::memory_order_acquire);
+            }
+        }
+
+    private:
+        ConvolutionReverb& owner;
+    };
+
+    /// hand the completed tail block to the worker, once its previous job is done
+    void postTailJob(Engine& _engine)
+    {
+        _engine.tailFill = 0;
+        const int slot = _engine.tailPeriod & 1;
+        _engine.tailPeriod++;
+
+        if (_engine.ir->getTail().numPartitions == 0)
+            return;
+
+        // the previous job's output plays from now on
+        waitForTailJob();
+        std::copy(_engine.tailStage.begin(), _engine.tailStage.end(), _engine.jobInput.begin() + ImpulseResponse::tailSize);
+
+        jobEngine = &_engine;
+        jobSlot = slot;
+
+        if (!started.load(std::memory_order_acquire) || worker == nullptr)
+        {
+            _engine.runTailJob(slot);
+            return;
+        }
+
+        jobPending.store(true, std::memory_order_release);
+        wakeCounter.fetch_add(1, std::memory_order_release);
+        wakeCounter.notify_one();
+    }
+
+    void waitForTailJob() const
+    {
+        SpinWait wait;
+        while (jobPending.load(std::memory_order_acquire))
+            wait.pause();
+    }
+
+    /// swap in a newly loaded engine, the active one is freed by the loader
+    void adoptPendingEngine()
+    {
+        if (!hasPending.load(std::memory_order_acquire))
+            return;
+
+        const juce::SpinLock::ScopedTryLockType lock(engineLock);
+        if (!lock.isLocked() || pending == nullptr || retired != nullptr)
+            return;
+
+        waitForTailJob();
+        retired = std::move(active);
+        active = std::move(pending);
+        hasPending.store(false, std::memory_order_release);
+    }
+
+    juce::SharedResourcePointer<ImpulseResponseCache> cache;
+    juce::File impulseResponseFile;
+
+    std::unique_ptr<Engine> active;                  // audio thread only
+    std::unique_ptr<Engine> pending;                 // loaded, waiting to be swapped in
+    std::unique_ptr<Engine> retired;                 // swapped out, waiting to be freed
+    juce::SpinLock engineLock;                       // guards pending and retired
+    std::atomic<bool> hasPending { false };
+    std::atomic<bool> ready { false };
+    std::atomic<int> numLoading { 0 };
+    std::atomic<int> tailSamples { 0 };
+
+    // tail job handoff, one job in flight
+    std::unique_ptr<Worker> worker;
+    std::atomic<bool> started { false };
+    int maxBlockSize = 512;
+    double sampleRate = 44100.0;
+    Engine* jobEngine = nullptr;
+    int jobSlot = 0;
+    std::atomic<bool> jobPending { false };
+    std::atomic<uint32_t> wakeCounter { 0 };
+
+    juce::ThreadPool loader { 1 };
+};
+
+#endif // CONVOLUTION_REVERB_H
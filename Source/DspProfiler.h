@@ -0,0 +1,577 @@
+/*
+  ==============================================================================
+
+    DspProfiler.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef DSP_PROFILER_H
+#define DSP_PROFILER_H
+
+// Compiled into every build, the timing is switched on and off at run time with DspProfiler::setActive().
+// Define it to 0 to compile the profiling out: the timers become empty inline functions, nothing is
+// measured or pushed, and no reader thread is started.
+#ifndef POLYSYNTH_PROFILING
+ #define POLYSYNTH_PROFILING 1
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include <JuceHeader.h>
+
+#if POLYSYNTH_PROFILING && JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+/// Stages of the audio thread that are timed separately.
+/// The voice stages are summed over all voices rendered in a block (CPU time, also on worker threads),
+/// voices, reverb and block are the time the audio thread spends in processBlock.
+struct DspStage
+{
+    enum
+    {
+        oscillators,        // Osc1 and Osc2, with the control rate updates and filter coefficients between their segments
+        unison,             // both unison banks
+        modulation,         // LFOs and modulation targets of a chunk
+        envelope,           // envelopes, levels and the voice mix
+        filter,             // voice filter
+        voices,             // the whole synthesiser: MIDI, every voice and the mix
+        reverb,
+        block,              // the whole processBlock
+        numStages
+    };
+
+    static const char* getName(int _stage)
+    {
+        static const char* const names[] = { "Oscillators", "Unison", "LFO / Mod", "Envelope", "Filter", "Voices", "Reverb", "Block" };
+        return juce::isPositiveAndBelow(_stage, (int) numStages) ? names[_stage] : "";
+    }
+};
+
+/// Stage timings of one processBlock call, passed from the audio thread to the reader thread.
+struct DspProfileFrame
+{
+    std::array<uint64_t, DspStage::numStages> ticks {};
+    uint64_t maxVoiceTicks = 0;                         // most expensive single voice
+    int numVoices = 0;                                  // voices rendered
+    int numSamples = 0;
+};
+
+/// Cheap cycle counter, the time stamp counter on x86 and the high resolution timer elsewhere.
+/// A lap adds the ticks since the previous lap to a stage, so one counter read closes one stage and opens the next.
+/// A disabled timer reads no counter, the engine enables it for the blocks the profiler times.
+class StageTimer
+{
+public:
+    static uint64_t now() noexcept
+    {
+       #if POLYSYNTH_PROFILING && JUCE_INTEL
+        return (uint64_t) __rdtsc();
+       #else
+        return (uint64_t) juce::Time::getHighResolutionTicks();
+       #endif
+    }
+
+    /// time the next block or not, set before the block is rendered
+    /// @param bool, true to read the counter at start() and lap()
+    void setEnabled(bool _enabled) noexcept
+    {
+       #if POLYSYNTH_PROFILING
+        enabled = _enabled;
+       #else
+        juce::ignoreUnused(_enabled);
+       #endif
+    }
+
+    /// start timing, the next lap is measured from here
+    void start() noexcept
+    {
+       #if POLYSYNTH_PROFILING
+        if (enabled)
+            last = now();
+       #endif
+    }
+
+    /// add the ticks since the previous lap to a stage
+    /// @param int, DspStage
+    void lap(int _stage) noexcept
+    {
+       #if POLYSYNTH_PROFILING
+        if (!enabled)
+            return;
+
+        const auto time = now();
+        ticks[(size_t) _stage] += time - last;
+        last = time;
+       #else
+        juce::ignoreUnused(_stage);
+       #endif
+    }
+
+    /// add the stage times to a frame and restart from zero
+    /// @param DspProfileFrame&, frame of the current block
+    /// @param bool, true for the timer of a voice, false for work shared by several voices
+    void collect(DspProfileFrame& _frame, bool _isVoice = true) noexcept
+    {
+       #if POLYSYNTH_PROFILING
+        uint64_t total = 0;
+        for (size_t i = 0; i < ticks.size(); i++)
+        {
+            _frame.ticks[i] += ticks[i];
+            total += ticks[i];
+            ticks[i] = 0;
+        }
+
+        if (_isVoice)
+        {
+            _frame.maxVoiceTicks = std::max(_frame.maxVoiceTicks, total);
+            _frame.numVoices++;
+        }
+       #else
+        juce::ignoreUnused(_frame, _isVoice);
+       #endif
+    }
+
+private:
+   #if POLYSYNTH_PROFILING
+    std::array<uint64_t, DspStage::numStages> ticks {};
+    uint64_t last = 0;
+    bool enabled = false;
+   #endif
+};
+
+/// Live profiling of the audio thread.
+/// The audio thread times its stages with StageTimers and pushes one frame per block into a lock-free
+/// single producer / single consumer FIFO; when the FIFO is full the frame is dropped and counted, the
+/// audio thread never waits. A reader thread drains the FIFO, converts ticks to time, keeps rolling
+/// min / average / p99 / max statistics over the last frames and optionally writes every frame to a CSV file.
+/// The timing is active by default in Debug builds and switched on from the editor in Release builds. While
+/// it is off the audio thread tests one flag per block and per lap, and the reader thread is not started.
+class DspProfiler
+{
+public:
+    static constexpr bool isEnabled = POLYSYNTH_PROFILING != 0;
+    static constexpr int fifoSize = 1024;               // frames, 1.3 s of 64 sample blocks at 48 kHz
+    static constexpr int windowSize = 2048;             // frames the statistics are computed over
+    static constexpr int readIntervalMs = 100;
+
+    /// statistics of one quantity over the window, in microseconds
+    struct Range
+    {
+        double min = 0.0, average = 0.0, p99 = 0.0, max = 0.0;
+    };
+
+    struct Statistics
+    {
+        std::array<Range, DspStage::numStages> stages;
+        Range voice;                                    // most expensive single voice of each block
+        Range load;                                     // block time in percent of the block duration
+        double averageVoices = 0.0;
+        int numFrames = 0;                              // frames in the window, 0 before the first block
+        uint64_t droppedFrames = 0;                     // frames lost because the FIFO was full
+    };
+
+    ~DspProfiler()
+    {
+        release();
+    }
+
+    /// keep the sample rate and start the reader thread if the timing is active (prepareToPlay)
+    /// @param double, sample rate
+    void prepare(double _sampleRate)
+    {
+       #if POLYSYNTH_PROFILING
+        release();
+
+        const juce::ScopedLock lock(readerLock);
+        sampleRate = _sampleRate;
+        fifo.reset();
+        prepared = true;
+
+        if (active.load(std::memory_order_relaxed))
+            startReader();
+       #else
+        juce::ignoreUnused(_sampleRate);
+       #endif
+    }
+
+    /// stop the reader thread (releaseResources)
+    void release()
+    {
+       #if POLYSYNTH_PROFILING
+        const juce::ScopedLock lock(readerLock);
+        prepared = false;
+
+        if (reader != nullptr)
+            reader->stopThread(1000);
+
+        reader.reset();
+       #endif
+    }
+
+    /// switch the timing on or off, the audio thread follows at its next block (message thread)
+    /// @param bool, true to time the blocks
+    void setActive(bool _active)
+    {
+       #if POLYSYNTH_PROFILING
+        active.store(_active, std::memory_order_relaxed);
+
+        const juce::ScopedLock lock(readerLock);
+        if (_active && prepared)
+            startReader();
+       #else
+        juce::ignoreUnused(_active);
+       #endif
+    }
+
+    /// true while the blocks are timed
+    bool isActive() const
+    {
+       #if POLYSYNTH_PROFILING
+        return active.load(std::memory_order_relaxed);
+       #else
+        return false;
+       #endif
+    }
+
+    //==============================================================================
+    // audio thread
+
+    /// start timing a processBlock call, if the timing is active
+    void beginBlock() noexcept
+    {
+       #if POLYSYNTH_PROFILING
+        timing = active.load(std::memory_order_relaxed);
+        if (!timing)
+            return;
+
+        frame = {};
+        blockStart = StageTimer::now();
+        lastLap = blockStart;
+       #endif
+    }
+
+    /// true if the current block is timed, the voices' StageTimers are enabled for it
+    bool isTiming() const noexcept
+    {
+       #if POLYSYNTH_PROFILING
+        return timing;
+       #else
+        return false;
+       #endif
+    }
+
+    /// add the time since the previous lap to a stage of the audio thread
+    /// @param int, DspStage
+    void lap(int _stage) noexcept
+    {
+       #if POLYSYNTH_PROFILING
+        if (!timing)
+            return;
+
+        const auto time = StageTimer::now();
+        frame.ticks[(size_t) _stage] += time - lastLap;
+        lastLap = time;
+       #else
+        juce::ignoreUnused(_stage);
+       #endif
+    }
+
+    /// add the stages of a rendered voice to the block
+    void addVoice(StageTimer& _voiceTimer) noexcept
+    {
+       #if POLYSYNTH_PROFILING
+        _voiceTimer.collect(frame);
+       #else
+        juce::ignoreUnused(_voiceTimer);
+       #endif
+    }
+
+    /// add the stages of a VoiceLaneGroup, rendered for several voices at once, to the block
+    void addLaneGroup(StageTimer& _groupTimer) noexcept
+    {
+       #if POLYSYNTH_PROFILING
+        _groupTimer.collect(frame, false);
+       #else
+        juce::ignoreUnused(_groupTimer);
+       #endif
+    }
+
+    /// finish the block and pass its frame to the reader thread
+    /// @param int, number of samples of the block
+    void endBlock(int _numSamples) noexcept
+    {
+       #if POLYSYNTH_PROFILING
+        if (!timing)
+            return;
+
+        frame.ticks[DspStage::block] = StageTimer::now() - blockStart;
+        frame.numSamples = _numSamples;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 > 0)
+        {
+            frames[(size_t) start1] = frame;
+            fifo.finishedWrite(1);
+        }
+        else
+        {
+            droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+       #else
+        juce::ignoreUnused(_numSamples);
+       #endif
+    }
+
+    //==============================================================================
+    // message thread
+
+    /// latest statistics of the reader thread
+    Statistics getStatistics() const
+    {
+        const juce::ScopedLock lock(statisticsLock);
+        return published;
+    }
+
+    /// write every frame to a CSV file, an empty file stops writing
+    /// @param juce::File&, file, replaced when writing starts
+    void setDumpFile(const juce::File& _file)
+    {
+        const juce::ScopedLock lock(statisticsLock);
+        dumpFile = _file;
+        dumpFileChanged = true;
+    }
+
+private:
+   #if POLYSYNTH_PROFILING
+    class Reader : public juce::Thread
+    {
+    public:
+        explicit Reader(DspProfiler& _owner) : juce::Thread("DSP Profiler"), owner(_owner) {}
+
+        void run() override
+        {
+            // the time stamp counter is calibrated against the high resolution timer while the thread runs
+            const auto startTicks = StageTimer::now();
+            const auto startTime = juce::Time::getHighResolutionTicks();
+
+            while (!threadShouldExit())
+            {
+                wait(readIntervalMs);
+
+               #if JUCE_INTEL
+                const double elapsed = (double) (juce::Time::getHighResolutionTicks() - startTime) / (double) juce::Time::getHighResolutionTicksPerSecond();
+                if (elapsed > 0.0)
+                    owner.ticksPerSecond = (double) (StageTimer::now() - startTicks) / elapsed;
+               #else
+                juce::ignoreUnused(startTicks, startTime);
+                owner.ticksPerSecond = (double) juce::Time::getHighResolutionTicksPerSecond();
+               #endif
+
+                owner.read();
+            }
+
+            owner.dump.reset();
+        }
+
+    private:
+        DspProfiler& owner;
+    };
+
+    /// start the reader thread once, it runs until release() (called with readerLock held)
+    void startReader()
+    {
+        if (reader != nullptr)
+            return;
+
+        reader = std::make_unique<Reader>(*this);
+        reader->startThread(juce::Thread::Priority::low);
+    }
+
+    /// drain the FIFO and update the statistics (reader thread)
+    void read()
+    {
+        updateDumpFile();
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; i++)
+            addToWindow(frames[(size_t) (start1 + i)]);
+        for (int i = 0; i < size2; i++)
+            addToWindow(frames[(size_t) (start2 + i)]);
+
+        fifo.finishedRead(size1 + size2);
+
+        if (dump != nullptr)
+            dump->flush();
+
+        updateStatistics();
+    }
+
+    void addToWindow(const DspProfileFrame& _frame)
+    {
+        if (window.empty())
+            window.resize((size_t) windowSize);
+
+        window[(size_t) windowPosition] = _frame;
+        windowPosition = (windowPosition + 1) % windowSize;
+        numInWindow = std::min(numInWindow + 1, windowSize);
+
+        if (dump != nullptr)
+            writeFrame(_frame);
+    }
+
+    double toMicroseconds(uint64_t _ticks) const
+    {
+        return ticksPerSecond > 0.0 ? (double) _ticks * 1.0e6 / ticksPerSecond : 0.0;
+    }
+
+    void updateStatistics()
+    {
+        Statistics statistics;
+        statistics.numFrames = numInWindow;
+        statistics.droppedFrames = droppedFrames.load(std::memory_order_relaxed);
+
+        if (numInWindow > 0)
+        {
+            for (int stage = 0; stage < DspStage::numStages; stage++)
+                statistics.stages[(size_t) stage] = getRange([stage](const DspProfileFrame& f, double us) { juce::ignoreUnused(f); return us; }, stage);
+
+            statistics.voice = getRange([this](const DspProfileFrame& f, double) { return toMicroseconds(f.maxVoiceTicks); }, DspStage::block);
+            statistics.load = getRange([this](const DspProfileFrame& f, double us) { return us * 1.0e-4 * sampleRate / juce::jmax(1, f.numSamples); }, DspStage::block);
+
+            double voices = 0.0;
+            for (int i = 0; i < numInWindow; i++)
+                voices += window[(size_t) i].numVoices;
+
+            statistics.averageVoices = voices / numInWindow;
+        }
+
+        const juce::ScopedLock lock(statisticsLock);
+        published = statistics;
+    }
+
+    /// statistics of a value over the window
+    /// @param Function, value of a frame, called with the frame and the time of the stage in microseconds
+    /// @param int, DspStage passed to the function
+    template <typename Function>
+    Range getRange(Function&& _valueOf, int _stage)
+    {
+        sortBuffer.clear();
+        for (int i = 0; i < numInWindow; i++)
+        {
+            const auto& f = window[(size_t) i];
+            sortBuffer.push_back(_valueOf(f, toMicroseconds(f.ticks[(size_t) _stage])));
+        }
+
+        std::sort(sortBuffer.begin(), sortBuffer.end());
+
+        Range range;
+        range.min = sortBuffer.front();
+        range.max = sortBuffer.back();
+        range.p99 = sortBuffer[(size_t) std::max(0, (int) std::ceil(0.99 * (double) sortBuffer.size()) - 1)];
+
+        for (auto value : sortBuffer)
+            range.average += value;
+        range.average /= (double) sortBuffer.size();
+
+        return range;
+    }
+
+    /// open or close the CSV file after setDumpFile() (reader thread)
+    void updateDumpFile()
+    {
+        juce::File file;
+        {
+            const juce::ScopedLock lock(statisticsLock);
+            if (!dumpFileChanged)
+                return;
+
+            file = dumpFile;
+            dumpFileChanged = false;
+        }
+
+        dump.reset();
+        if (file.getFullPathName().isEmpty())
+            return;
+
+        file.deleteFile();
+        dump = std::make_unique<juce::FileOutputStream>(file);
+        if (!dump->openedOk())
+        {
+            dump.reset();
+            return;
+        }
+
+        juce::String header("samples,voices");
+        for (int stage = 0; stage < DspStage::numStages; stage++)
+            header += juce::String(",") + DspStage::getName(stage) + " (us)";
+        header += ",max voice (us)\n";
+        dump->writeText(header, false, false, nullptr);
+    }
+
+    void writeFrame(const DspProfileFrame& _frame)
+    {
+        char line[512];
+        int length = std::snprintf(line, sizeof(line), "%d,%d", _frame.numSamples, _frame.numVoices);
+
+        for (auto ticks : _frame.ticks)
+            length += std::snprintf(line + length, sizeof(line) - (size_t) length, ",%.2f", toMicroseconds(ticks));
+
+        std::snprintf(line + length, sizeof(line) - (size_t) length, ",%.2f\n", toMicroseconds(_frame.maxVoiceTicks));
+        dump->writeText(line, false, false, nullptr);
+    }
+
+   #if JUCE_DEBUG
+    std::atomic<bool> active { true };
+   #else
+    std::atomic<bool> active { false };
+   #endif
+
+    // audio thread
+    bool timing = false;                                // active at the start of the current block
+    DspProfileFrame frame;
+    uint64_t blockStart = 0;
+    uint64_t lastLap = 0;
+
+    // FIFO between the audio thread and the reader
+    juce::AbstractFifo fifo { fifoSize };
+    std::array<DspProfileFrame, fifoSize> frames;
+    std::atomic<uint64_t> droppedFrames { 0 };
+
+    // reader thread, started and stopped under readerLock
+    juce::CriticalSection readerLock;
+    bool prepared = false;
+    std::unique_ptr<Reader> reader;
+    double sampleRate = 44100.0;
+    double ticksPerSecond = 0.0;
+    std::vector<DspProfileFrame> window;
+    int windowPosition = 0;
+    int numInWindow = 0;
+    std::vector<double> sortBuffer;
+    std::unique_ptr<juce::FileOutputStream> dump;
+   #endif
+
+    // shared between the reader and the message thread
+    juce::CriticalSection statisticsLock;
+    Statistics published;
+    juce::File dumpFile;
+    bool dumpFileChanged = false;
+};
+
+#endif // DSP_PROFILER_H
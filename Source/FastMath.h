@@ -0,0 +1,168 @@
+/*
+  ==============================================================================
+
+    FastMath.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <bit>
+#include <cstdint>
+
+/// Polynomial and rational approximations of the math functions of the synth's hot paths, in three
+/// accuracy tiers. Every function is constexpr, inline and branch-free (the selects compile to blends),
+/// so a loop over an array of values vectorises; nothing is looked up except pitchToFrequency()'s 12 semitones.
+/// Each component picks the tier it needs as a compile-time constant next to its code.
+///
+/// Maximum errors, measured over the whole domain in float against the double libm functions
+/// (PolyphonicSynthBenchmark --math checks them):
+///
+///   function                  domain                 draft       normal      precise
+///   sin2Pi (absolute)         |x| < 2^23             7e-5        8e-7        2e-7
+///   sin (absolute)            |x| <= 4 pi            7e-5        2e-6        1e-6
+///   tan (relative)            |x| <= 0.49 pi         3e-4        3e-6        1e-7
+///                             |x| <= 0.25 pi         3e-7        3e-7        1e-7
+///   exp2 (relative)           -126 <= x < 128        9e-5        3e-6        2e-7
+///   pitchToFrequency (rel.)   MIDI notes 0 - 127     9e-5        4e-6        5e-7
+///
+/// sin2Pi() removes the whole cycles with a float to int conversion: from 2^23, where every float is a whole
+/// number of cycles, it rounds half of them the wrong way, and from 2^31 the conversion is undefined.
+/// Oscillator and LFO phases stay within a few cycles.
+///
+/// sin() multiplies by 1 / 2 pi in float first, the rounding of the product grows with |x| and is most of
+/// its error beyond the first cycles. tan() near 0.49 pi is as accurate as its float argument allows in
+/// draft and normal, precise evaluates in double.
+///
+/// exp2() is exactly 1 at 0 and exactly 2^n at every integer n, in every tier.
+struct FastMath
+{
+    enum Accuracy
+    {
+        draft,      // modulation and control signals
+        normal,     // filter coefficients, pitch modulation
+        precise     // audio signals, within a few float ulps
+    };
+
+    /// sin(2 pi x), x in cycles (an oscillator phase), |x| < 2^23
+    template <Accuracy accuracy>
+    static constexpr float sin2Pi(float _x)
+    {
+        // reduce to [-0.5, 0.5], then fold onto [-0.25, 0.25], where sin(2 pi (0.5 - t)) = sin(2 pi t);
+        // the sign is moved as a bit, selects on it would keep GCC from vectorising the loop
+        const float reduced = _x - roundToInt(_x);
+        const uint32_t bits = std::bit_cast<uint32_t>(reduced);
+        const float magnitude = std::bit_cast<float>(bits & 0x7fffffffu);
+        const float mirrored = 0.5f - magnitude;
+        const float folded = magnitude < mirrored ? magnitude : mirrored;
+        const float t = std::bit_cast<float>(std::bit_cast<uint32_t>(folded) | (bits & 0x80000000u));
+
+        const float t2 = t * t;
+        if constexpr (accuracy == draft)
+            return t * (6.28128040f + t2 * (-41.0952605f + t2 * 73.5857243f));
+        else if constexpr (accuracy == normal)
+            return t * (6.28316405f + t2 * (-41.3371429f + t2 * (81.3407845f + t2 * -70.9935671f)));
+        else
+            return t * (6.28318516f + t2 * (-41.3416550f + t2 * (81.6010040f + t2 * (-76.5497808f + t2 * 39.5366939f))));
+    }
+
+    /// sin(x), x in radians
+    template <Accuracy accuracy>
+    static constexpr float sin(float _x)
+    {
+        return sin2Pi<accuracy>(_x * 0.159154943f);
+    }
+
+    /// tan(x), |x| <= 0.49 pi (the cutoff of a bilinear filter up to 0.49 of the sample rate), the
+    /// Pade approximants of tan: [5/4] for draft, [7/6] for normal, [7/6] in double for precise
+    template <Accuracy accuracy>
+    static constexpr float tan(float _x)
+    {
+        if constexpr (accuracy == draft)
+        {
+            const float x2 = _x * _x;
+            return _x * (945.0f + x2 * (-105.0f + x2)) / (945.0f + x2 * (-420.0f + x2 * 15.0f));
+        }
+        else if constexpr (accuracy == normal)
+        {
+            return pade76(_x);
+        }
+        else
+        {
+            return (float) pade76((double) _x);
+        }
+    }
+
+    /// 2^x, the exponent is set directly and the fraction is a polynomial
+    /// @param float, -126 <= x < 128, not clamped (a clamp keeps GCC from vectorising the loop)
+    template <Accuracy accuracy>
+    static constexpr float exp2(float _x)
+    {
+        const float n = floor(_x, 128);
+        const float f = _x - n;
+
+        // 2^f - 1 = f P(f) on [0, 1), relative minimax, so 2^0 is exactly 1
+        float p;
+        if constexpr (accuracy == draft)
+            p = f * (0.695116802f + f * (0.227644954f + f * 0.0770670638f));
+        else if constexpr (accuracy == normal)
+            p = f * (0.693044844f + f * (0.241280210f + f * (0.0522424664f + f * 0.0134266877f)));
+        else
+            p = f * (0.693151312f + f * (0.240164450f + f * (0.0557999142f + f * (0.00901702926f + f * 0.00186713045f))));
+
+        return (1.0f + p) * powerOfTwo((int) n);
+    }
+
+    /// frequency of a MIDI note, A4 (69) at 440 Hz, fractional notes in between
+    /// @param float, note, 0 - 127 and beyond while the frequency is a normal float
+    template <Accuracy accuracy>
+    static constexpr float pitchToFrequency(float _note)
+    {
+        // octaves above A4 set the exponent, whole semitones come from the table, already rounded, so
+        // whole notes are the correctly rounded frequency, only the fraction of a semitone is approximated
+        const float semitones = _note - 69.0f;
+        const float octave = floor(semitones / 12.0f, 16);
+        const float inOctave = semitones - 12.0f * octave;
+        const int truncated = (int) inOctave;
+        const int semitone = truncated < 11 ? truncated : 11;   // 12 when a note just below an octave rounds up
+
+        return octaveOfA4[semitone] * powerOfTwo((int) octave) * exp2<accuracy>((inOctave - (float) semitone) * (1.0f / 12.0f));
+    }
+
+private:
+    // the semitones from A4 up, each the correctly rounded float of 440 * 2^(n / 12)
+    static constexpr float octaveOfA4[] = { 440.0f, 466.163757f, 493.883301f, 523.25116f, 554.365234f, 587.329529f,
+                                            622.253967f, 659.255127f, 698.456482f, 739.988831f, 783.990845f, 830.609375f };
+
+    static constexpr float roundToInt(float _x)
+    {
+        return (float) (int) (_x + (_x < 0.0f ? -0.5f : 0.5f));
+    }
+
+    /// floor(x) for x > -offset, the truncation of a positive number (a select after the conversion would not vectorise);
+    /// an x just below an integer can round up to it, its fraction is then a tiny negative number
+    static constexpr float floor(float _x, int _offset)
+    {
+        return (float) ((int) (_x + (float) _offset) - _offset);
+    }
+
+    /// 2^n as a float, -126 <= n <= 127
+    static constexpr float powerOfTwo(int _n)
+    {
+        return std::bit_cast<float>((uint32_t) (_n + 127) << 23);
+    }
+
+    template <typename Type>
+    static constexpr Type pade76(Type _x)
+    {
+        const Type x2 = _x * _x;
+        return _x * ((Type) 135135 + x2 * ((Type) -17325 + x2 * ((Type) 378 - x2)))
+                  / ((Type) 135135 + x2 * ((Type) -62370 + x2 * ((Type) 3150 - (Type) 28 * x2)));
+    }
+};
+
+#endif // FAST_MATH_H
@@ -14,13 +14,26 @@
 #define FILTER_MOD_H
 
 #include <JuceHeader.h> // for defining juce classes variables
+#include "FilterCoefficientCache.h"
+#include "StateVariableFilter.h"
 //#include "Parameters.h" // for accessing parameters set by the user interface
 
 /// Filter class.
 /// Filter type can be set by using setType() class method.
+/// Types 0 - 2 are biquads (juce::IIRFilter), types 3 - 6 the state-variable filter (StateVariableFilter.h),
+/// which is cheap enough to recalculate on every sample and is never looked up in the coefficient cache.
 class Filter
 {
 public:
+    static constexpr int firstStateVariableType = 3;
+
+    /// @param int, filter type
+    /// @return bool, true for the state-variable types
+    static bool isStateVariable(int _filterType)
+    {
+        return _filterType >= firstStateVariableType;
+    }
+
     /// constructor that resets filter instance and initialises frequency range for cutoff and resonance
     /// @param juce::NormalisableRange<float>, range for cutoff frequency
     /// @param juce::NormalisableRange<float>, range for resonance
@@ -43,9 +56,49 @@ public:
 
         // reset modulations
         resetModulations();
+        return processSample(_inSample);
+    }
+
+    /// recalculate the coefficients from the base cutoff plus the current modulation,
+    /// used by the control-rate path so that makeFilter() does not run on every sample
+    /// @param int, filter type
+    void updateCoefficients(int _filterType)
+    {
+        (*this).setFrequency(cutoffbase + frequencyOffset);
+        (*this).makeFilter(_filterType);
+
+        resetModulations();
+    }
+
+    /// process input sample with the coefficients set by the last updateCoefficients() call
+    /// @param float, input sample
+    /// @return float, filter output
+    float processSample(float _inSample)
+    {
+        if (isStateVariable(currentType))
+            return stateVariableFilter.processSample(_inSample, stateVariableCoefficients);
+
         return filter.processSingleSampleRaw(_inSample);
     }
 
+    /// true if the current coefficients are the state-variable filter's
+    bool isStateVariable() const
+    {
+        return isStateVariable(currentType);
+    }
+
+    /// biquad coefficients set by the last startNote() or updateCoefficients() call
+    juce::IIRCoefficients getCoefficients() const
+    {
+        return filter.getCoefficients();
+    }
+
+    /// state-variable coefficients set by the last startNote() or updateCoefficients() call
+    const StateVariableCoefficients& getStateVariableCoefficients() const
+    {
+        return stateVariableCoefficients;
+    }
+
     /// set sample rate
     /// @param float, sample rate
     void setSampleRate(float _sampleRate)
@@ -74,23 +127,51 @@ public:
     }
 
     /// set filter type
-    /// @param int, filter type (0 - low pass, 1 - high pass, 2 - band pass, 3 - notch
+    /// @param int, filter type (0 - low pass, 1 - high pass, 2 - band pass, 3 - 6 state-variable low pass, high pass, band pass, notch)
     void makeFilter(int _filterType)
     {
+        // only recalculate when the inputs actually changed
+        if (_filterType == currentType && cutoff == currentCutoff && Q == currentQ && sampleRate == currentSampleRate)
+            return;
+
+        currentType = _filterType;
+        currentCutoff = cutoff;
+        currentQ = Q;
+        currentSampleRate = sampleRate;
+
+        if (isStateVariable(_filterType))
+        {
+            stateVariableCoefficients = StateVariableCoefficients::make(sampleRate, cutoff, Q, _filterType - firstStateVariableType);
+            return;
+        }
+
+        // interpolate from the shared table when it covers the cutoff, otherwise (modulated cutoff
+        // outside the parameter range) calculate the coefficients directly
+        if (coefficientCache != nullptr && coefficientCache->getSampleRate() == sampleRate && coefficientCache->covers(cutoff))
+        {
+            filter.setCoefficients(coefficientCache->getCoefficients(_filterType, cutoff, Q));
+            return;
+        }
+
+        // the limits of the table and the state-variable types: Q = 0 divides by zero, and a modulated
+        // cutoff below zero or past Nyquist gives NaN or unstable coefficients that stay in the lane's state
+        const float directCutoff = juce::jlimit(1.0f, StateVariableCoefficients::maxCutoffRatio * (float) sampleRate, cutoff);
+        const float directQ = juce::jmax(FilterCoefficientCache::minQ, Q);
+
         switch (_filterType)
         {
         case 0:
             //setFilterCoefficientsFunction(&(juce::IIRCoefficients::makeLowPass));
-            filter.setCoefficients(juce::IIRCoefficients::makeLowPass(sampleRate, cutoff, Q));
+            filter.setCoefficients(juce::IIRCoefficients::makeLowPass(sampleRate, directCutoff, directQ));
             //filter.setCoefficients(juce::IIRCoefficients::makeLowPass);
             break;
         case 1:
             //setFilterCoefficientsFunction(&(juce::IIRCoefficients::makeHighPass));
-            filter.setCoefficients(juce::IIRCoefficients::makeHighPass(sampleRate, cutoff, Q));
+            filter.setCoefficients(juce::IIRCoefficients::makeHighPass(sampleRate, directCutoff, directQ));
             break;
         case 2:
             //setFilterCoefficientsFunction(&(juce::IIRCoefficients::makeBandPass));
-            filter.setCoefficients(juce::IIRCoefficients::makeBandPass(sampleRate, cutoff, Q));
+            filter.setCoefficients(juce::IIRCoefficients::makeBandPass(sampleRate, directCutoff, directQ));
             break;
             //case 3:
             //    //setFilterCoefficientsFunction(&(juce::IIRCoefficients::makeNotchFilter));
@@ -99,6 +180,13 @@ public:
         }
     }
 
+    /// use a coefficient table shared with the other voices
+    /// @param FilterCoefficientCache*, table owned by the processor (nullptr calculates every update)
+    void setCoefficientCache(const FilterCoefficientCache* _coefficientCache)
+    {
+        coefficientCache = _coefficientCache;
+    }
+
 
     /// set frequency offset when using a LFO on filter's cutoffFreq
 /// @param float, amount convert from Amount% in UI
@@ -117,6 +205,7 @@ public:
     void startNote(float _sampleRate, float _frequency, float _resonance, int _filterType)
     {
         filter.reset();
+        stateVariableFilter.reset();
         // env.reset();
 
         (*this).setSampleRate(_sampleRate);
@@ -131,6 +220,8 @@ private:
     float sampleRate = 0.0f;                                                                         // sample rate [Hz]
     // base members
     juce::IIRFilter filter;                                                                          // filter instance
+    StateVariableFilter stateVariableFilter;                                                         // the state-variable types, processSample() only
+    StateVariableCoefficients stateVariableCoefficients;
     juce::IIRCoefficients(*makeFilterCoefficients) (double sampleRate, double frequency, double Q); // pointer to a function with calculates filter coefficiens using specified sample rate, cutoff frequency and resonance
     // juce::ADSR env;                                                                                  // filter cutoff envelope
      // filter parameters
@@ -138,6 +229,11 @@ private:
     float Q;  // resonance;
     float frequencyOffset = 0.0f;
 
+    // coefficient cache
+    const FilterCoefficientCache* coefficientCache = nullptr;
+    int currentType = -1;                                                                            // inputs of the coefficients currently set
+    float currentCutoff = 0.0f, currentQ = 0.0f, currentSampleRate = 0.0f;
+
 };
 
 #endif // FILTER_MOD_H
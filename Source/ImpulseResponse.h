@@ -0,0 +1,226 @@
+/*
+  ==============================================================================
+
+    ImpulseResponse.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef IMPULSE_RESPONSE_H
+#define IMPULSE_RESPONSE_H
+
+#include <memory>
+#include <vector>
+#include <JuceHeader.h>
+
+/// The partitioned spectra of one stereo impulse response, read-only once loaded and shared by every
+/// ConvolutionReverb that uses the same file. The response is split into three parts of growing size:
+///   direct  [0, directLength)          time-domain taps, convolved per sample
+///   head    [directLength, headEnd)     partitions of headSize samples, FFT size 2 * headSize
+///   tail    [headEnd, length)           partitions of tailSize samples, FFT size 2 * tailSize
+/// Each part starts where its partitions can be computed in time without adding latency.
+class ImpulseResponse : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<ImpulseResponse>;
+
+    static constexpr int directLength = 64;
+    static constexpr int headSize = 64;
+    static constexpr int headOrder = 7;              // FFT size 128
+    static constexpr int tailSize = 1024;
+    static constexpr int tailOrder = 11;             // FFT size 2048
+    static constexpr int headEnd = 2 * tailSize;
+    static constexpr int maxLength = 1 << 20;        // longer files are truncated, about 22 s at 48 kHz
+
+    /// spectra of the partitions of one part, bins 0..size stored as all real parts then all imaginary parts,
+    /// which keeps the complex multiply-add of the convolution vectorisable
+    struct Partitions
+    {
+        int size = 0;                                // samples per partition
+        int numPartitions = 0;
+        std::vector<float> spectra[2];               // numPartitions * getSpectrumSize() per channel
+
+        int getNumBins() const { return size + 1; }
+        int getSpectrumSize() const { return 2 * getNumBins(); }
+        const float* getSpectrum(int _channel, int _partition) const { return spectra[_channel].data() + (size_t) (_partition * getSpectrumSize()); }
+    };
+
+    /// memory-map an audio file and partition it, on the calling thread
+    /// @param juce::File, a format with a memory-mapped reader (WAV, AIFF)
+    /// @return Ptr, nullptr if the file can't be mapped
+    static Ptr load(const juce::File& _file)
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        auto* format = formats.findFormatForFileExtension(_file.getFileExtension());
+        if (format == nullptr)
+            return nullptr;
+
+        // the samples are read straight from the mapped file, a chunk at a time, into the FFT buffers
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader(format->createMemoryMappedReader(_file));
+        if (reader == nullptr || !reader->mapEntireFile() || reader->lengthInSamples <= 0)
+            return nullptr;
+
+        Ptr ir = new ImpulseResponse(_file, *reader);
+        return ir;
+    }
+
+    const juce::File& getFile() const { return file; }
+    juce::Time getModificationTime() const { return modificationTime; }
+    int getLength() const { return length; }
+    double getSampleRate() const { return sampleRate; }
+
+    const float* getDirect(int _channel) const { return direct[_channel].data(); }
+
+    /// reorder the interleaved output of juce::dsp::FFT::performRealOnlyForwardTransform to split real and imaginary parts
+    /// @param float*, interleaved spectrum, 2 * _numBins values
+    /// @param float*, split spectrum
+    /// @param int, number of bins
+    static void splitSpectrum(const float* _interleaved, float* _split, int _numBins)
+    {
+        for (int k = 0; k < _numBins; k++)
+        {
+            _split[k] = _interleaved[2 * k];
+            _split[_numBins + k] = _interleaved[2 * k + 1];
+        }
+    }
+
+    /// the inverse of splitSpectrum, for juce::dsp::FFT::performRealOnlyInverseTransform
+    static void interleaveSpectrum(const float* _split, float* _interleaved, int _numBins)
+    {
+        for (int k = 0; k < _numBins; k++)
+        {
+            _interleaved[2 * k] = _split[k];
+            _interleaved[2 * k + 1] = _split[_numBins + k];
+        }
+    }
+    const Partitions& getHead() const { return head; }
+    const Partitions& getTail() const { return tail; }
+
+private:
+    ImpulseResponse(const juce::File& _file, juce::MemoryMappedAudioFormatReader& _reader)
+        : file(_file), modificationTime(_file.getLastModificationTime()), sampleRate(_reader.sampleRate)
+    {
+        length = (int) juce::jmin((juce::int64) maxLength, _reader.lengthInSamples);
+
+        // the reader copies a mono file into both channels
+        juce::AudioBuffer<float> chunk(2, tailSize);
+        double energy[2] = { 0.0, 0.0 };
+
+        auto readChunk = [&](int _start, int _numSamples)
+        {
+            chunk.clear();
+            _reader.read(&chunk, 0, _numSamples, _start, true, true);
+
+            for (int channel = 0; channel < 2; channel++)
+                for (int i = 0; i < _numSamples; i++)
+                    energy[channel] += (double) chunk.getSample(channel, i) * chunk.getSample(channel, i);
+        };
+
+        for (int channel = 0; channel < 2; channel++)
+            direct[channel].assign(directLength, 0.0f);
+
+        readChunk(0, juce::jmin(length, directLength));
+        for (int channel = 0; channel < 2; channel++)
+            std::copy(chunk.getReadPointer(channel), chunk.getReadPointer(channel) + juce::jmin(length, directLength), direct[channel].begin());
+
+        partition(head, headOrder, headSize, directLength, juce::jmin(length, headEnd), chunk, readChunk);
+        partition(tail, tailOrder, tailSize, headEnd, length, chunk, readChunk);
+
+        // normalise to unit energy on the louder channel, the wet level then matches the dry level
+        // for noise-like input whatever the length of the response
+        const double maxEnergy = juce::jmax(energy[0], energy[1]);
+        const float gain = maxEnergy > 0.0 ? (float) (1.0 / std::sqrt(maxEnergy)) : 0.0f;
+
+        for (int channel = 0; channel < 2; channel++)
+        {
+            for (auto& tap : direct[channel])
+                tap *= gain;
+            for (auto& value : head.spectra[channel])
+                value *= gain;
+            for (auto& value : tail.spectra[channel])
+                value *= gain;
+        }
+    }
+
+    /// transform the samples [_start, _end) in partitions of _size samples, zero-padded to twice the size
+    template <typename ReadChunk>
+    static void partition(Partitions& _partitions, int _order, int _size, int _start, int _end,
+                          juce::AudioBuffer<float>& _chunk, ReadChunk& _readChunk)
+    {
+        _partitions.size = _size;
+        _partitions.numPartitions = _end > _start ? (_end - _start + _size - 1) / _size : 0;
+
+        juce::dsp::FFT fft(_order);
+        std::vector<float> buffer((size_t) (4 * _size));
+
+        for (int channel = 0; channel < 2; channel++)
+            _partitions.spectra[channel].assign((size_t) (_partitions.numPartitions * _partitions.getSpectrumSize()), 0.0f);
+
+        for (int p = 0; p < _partitions.numPartitions; p++)
+        {
+            const int start = _start + p * _size;
+            const int numSamples = juce::jmin(_size, _end - start);
+            _readChunk(start, numSamples);
+
+            for (int channel = 0; channel < 2; channel++)
+            {
+                std::fill(buffer.begin(), buffer.end(), 0.0f);
+                std::copy(_chunk.getReadPointer(channel), _chunk.getReadPointer(channel) + numSamples, buffer.begin());
+                fft.performRealOnlyForwardTransform(buffer.data(), true);
+
+                splitSpectrum(buffer.data(), _partitions.spectra[channel].data() + p * _partitions.getSpectrumSize(), _partitions.getNumBins());
+            }
+        }
+    }
+
+    juce::File file;
+    juce::Time modificationTime;
+    double sampleRate = 44100.0;
+    int length = 0;
+
+    std::vector<float> direct[2];
+    Partitions head;
+    Partitions tail;
+
+    JUCE_DECLARE_NON_COPYABLE(ImpulseResponse)
+};
+
+/// Impulse responses loaded by any plugin instance in the process, held through a
+/// juce::SharedResourcePointer: a file used by several instances is mapped and partitioned once.
+class ImpulseResponseCache
+{
+public:
+    /// the loaded response of a file, loading it if no instance holds it
+    /// @param juce::File, impulse response file
+    /// @return ImpulseResponse::Ptr, nullptr if the file can't be loaded
+    ImpulseResponse::Ptr get(const juce::File& _file)
+    {
+        const juce::ScopedLock lock(cacheLock);
+
+        // responses only the cache still refers to are dropped
+        responses.erase(std::remove_if(responses.begin(), responses.end(),
+                                       [](const ImpulseResponse::Ptr& _ir) { return _ir->getReferenceCount() == 1; }),
+                        responses.end());
+
+        for (auto& ir : responses)
+            if (ir->getFile() == _file && ir->getModificationTime() == _file.getLastModificationTime())
+                return ir;
+
+        // loading holds the lock, another instance asking for the same file waits and shares the result
+        auto ir = ImpulseResponse::load(_file);
+        if (ir != nullptr)
+            responses.push_back(ir);
+
+        return ir;
+    }
+
+private:
+    juce::CriticalSection cacheLock;
+    std::vector<ImpulseResponse::Ptr> responses;
+};
+
+#endif // IMPULSE_RESPONSE_H
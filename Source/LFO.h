@@ -9,15 +9,28 @@
 class LFO
 {
 public:
+    // a modulation signal; not draft, an LFO on the pitch would integrate its error into the oscillator phase
+    static constexpr FastMath::Accuracy sineAccuracy = FastMath::normal;
+    using LFOSinOsc = BasicSinOsc<sineAccuracy>;
+
     // Define a variant to hold any type of oscillator
-    using OscVariant = std::variant<SinOsc, TriOsc, SawOsc, SqrOsc>;
+    using OscVariant = std::variant<LFOSinOsc, TriOsc, SawOsc, SqrOsc>;
 
-    LFO() : lfo(SinOsc{}) {} // Initialize with a default SinOsc
+    LFO() : lfo(LFOSinOsc{}) {} // Initialize with a default SinOsc
 
     float process()
+    {
+        return process(1);
+    }
+
+    /// advance the LFO by several samples at once (control-rate modulation)
+    /// @param int, number of samples to advance
+    /// @return float, LFO value at the end of the interval
+    float process(int _numSamples)
     {
         // FM
-        float freq = frequency + frequencyOffset;
+        // the phase is stepped once, by the increment of the whole interval
+        float freq = (frequency + frequencyOffset) * _numSamples;
         std::visit([freq](auto& os) { os.setFrequency(freq); }, lfo);
 
         // PM
@@ -25,7 +38,23 @@ public:
         float lfoSample = (std::visit([](auto& os) { return os.process(); }, lfo));
         lfoSample = amount * lfoSample;
         smoothedLFOValue.setTargetValue(lfoSample);
-        return smoothedLFOValue.getNextValue();
+        return smoothedLFOValue.skip(_numSamples);
+    }
+
+    /// render a block of LFO values, the same values as calling process() numSamples times
+    /// @param float*, destination
+    /// @param int, number of samples
+    void process(float* _dest, int _numSamples)
+    {
+        float ph = std::visit([](auto& os) { return os.getPhase(); }, lfo);
+        kernel(_dest, _numSamples, ph, (frequency + frequencyOffset) / sampleRate);
+        std::visit([ph](auto& os) { os.setPhase(ph); }, lfo);
+
+        for (int i = 0; i < _numSamples; i++)
+        {
+            smoothedLFOValue.setTargetValue(amount * _dest[i]);
+            _dest[i] = smoothedLFOValue.getNextValue();
+        }
     }
 
     void setSampleRate(float _sampleRate)
@@ -40,7 +69,7 @@ public:
         switch (_waveshapeId)
         {
         case 0:
-            lfo.emplace<SinOsc>();
+            lfo.emplace<LFOSinOsc>();
             break;
         case 1:
             lfo.emplace<TriOsc>();
@@ -52,9 +81,11 @@ public:
             lfo.emplace<SqrOsc>();
             break;
         default:
-            lfo.emplace<SinOsc>(); // Default case
+            lfo.emplace<LFOSinOsc>(); // Default case
         }
 
+        kernel = OscKernels::getFixed<sineAccuracy>(_waveshapeId);
+
         std::visit([this](auto& os) { os.setSampleRate(sampleRate); os.setFrequency(frequency); os.setPhase(phase); }, lfo);
         
     }
@@ -97,74 +128,10 @@ public:
         (*this).setAmount(_LFOAmount);
         smoothedLFOValue.setCurrentAndTargetValue(0.0f);
     }
-    /// check if LFO is applied to the operator level
-/// @param int, LFO destination
-/// @param int, number of operators in the synth
-/// @return bool, true if LFO is applied
-    bool isAppliedToOsc1AM(int lfoDestination)
-    {
-        if (lfoDestination == 0)
-            return true;
-        else
-            return false;
-    }
-
-
-    bool isAppliedToOsc2AM(int lfoDestination)
-    {
-        if (lfoDestination == 1)
-            return true;
-        else
-            return false;
-    }
-
-    bool isAppliedToOsc1FM(int lfoDestination)
-    {
-        if (lfoDestination == 2)
-            return true;
-        else
-            return false;
-    }
-
-    bool isAppliedToOsc2FM(int lfoDestination)
-    {
-        if (lfoDestination == 3)
-            return true;
-        else
-            return false;
-    }
-
-    bool isAppliedToOsc1PM(int lfoDestination)
-    {
-        if (lfoDestination == 4)
-            return true;
-        else
-            return false;
-    }
-
-    bool isAppliedToOsc2PM(int lfoDestination)
-    {
-        if (lfoDestination == 5)
-            return true;
-        else
-            return false;
-    }
-
-
-    /// check if LFO is applied to filter cutoff frequency
-/// Input lfoDestination the 7th in list is FilterFreq 
-/// @return bool, true if LFO is applied
-    bool isAppliedToFilterCutoffFreq(int lfoDestination)
-    {
-        if (lfoDestination == 6)
-            return true;
-        else
-            return false;
-    }
-
 
 private:
     OscVariant lfo;
+    OscKernels::Fixed kernel = OscKernels::getFixed<sineAccuracy>(0);   // block kernel matching lfo
     juce::SmoothedValue<float> smoothedLFOValue;
     float sampleRate = 0.0f;
     float frequency = 0.0f;
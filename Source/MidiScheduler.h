@@ -0,0 +1,205 @@
+/*
+  ==============================================================================
+
+    MidiScheduler.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef MIDI_SCHEDULER_H
+#define MIDI_SCHEDULER_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <JuceHeader.h>
+#include "FastMath.h"
+
+/// Sorts the MIDI of a block before it reaches juce::Synthesiser, which splits its rendering at every event.
+/// Events that start or stop notes (note on/off, all notes/sound off, sustain and sostenuto pedals) keep
+/// their sample position. Pitch bend is folded into a per-sample ramp through the positions of its events,
+/// read by the voices as a frequency ratio, and the other controllers are applied at the start of the block,
+/// where they don't split it. juce::Synthesiser passes every controller event to every voice, so each
+/// controller is reduced to its last value of the block. The blocks are then only split by notes and the
+/// voices see at most one event per controller, so dense controller input costs about as much as none.
+class MidiScheduler
+{
+public:
+    static constexpr float pitchBendRange = 2.0f;    // semitones at full wheel
+    static constexpr int numControllers = 16 * 128;  // channels x controller numbers
+    static constexpr int reservedEvents = 2048;      // events of a block the note buffer holds without allocating
+
+    /// choices shown for the "MinSubBlock" parameter
+    static juce::StringArray getMinimumSubBlockChoices()
+    {
+        return { "1 Sample", "16 Samples", "32 Samples", "64 Samples" };
+    }
+
+    /// convert the "MinSubBlock" choice index to the shortest sub-block the synth renders between two note events
+    /// @param int, choice index
+    /// @return int, samples, 1 renders every note at its sample
+    static int getMinimumSubBlockSize(int _choice)
+    {
+        switch (_choice)
+        {
+        case 1:
+            return 16;
+        case 2:
+            return 32;
+        case 3:
+            return 64;
+        default:
+            return 1;
+        }
+    }
+
+    /// allocate the buffers (prepareToPlay)
+    /// @param int, maximum block size
+    void prepare(int _maxBlockSize)
+    {
+        semitones.assign((size_t) juce::jmax(1, _maxBlockSize), 0.0f);
+        pitchBendRatio.assign((size_t) juce::jmax(1, _maxBlockSize), 1.0f);
+        // ensureSize() takes bytes, an event is stored as its position, its size and its (up to 3) bytes
+        noteEvents.ensureSize((size_t) reservedEvents * (sizeof(int32_t) + sizeof(uint16_t) + 3));
+        controllerValues.fill(0);
+        controllerChanged.fill(false);
+        numChangedControllers = 0;
+        pitchBend = 0.0f;
+    }
+
+    /// sort the MIDI of a block (start of processBlock)
+    /// @param juce::MidiBuffer&, the host's MIDI for the block
+    /// @param int, first sample of the part being rendered, the events are moved to the start of the part
+    /// @param int, number of samples in the part
+    /// @param bool, true if the part ends the block, it also takes the events past the end
+    void schedule(const juce::MidiBuffer& _midi, int _startSample, int _numSamples, bool _lastPart)
+    {
+        // the processor splits longer host blocks into parts of the prepared size
+        jassert(_numSamples <= (int) semitones.size());
+
+        noteEvents.clear();
+
+        // the wheel moves in straight lines between the values of its events, starting from the last block's value
+        int bendPosition = 0;
+        float bend = pitchBend;
+        bool bendMoves = false;
+
+        const int endSample = _startSample + _numSamples;
+
+        for (auto it = _midi.findNextSamplePosition(_startSample); it != _midi.end(); ++it)
+        {
+            const auto metadata = *it;
+            if (metadata.samplePosition >= endSample && !_lastPart)
+                break;
+
+            const auto message = metadata.getMessage();
+            const int samplePosition = metadata.samplePosition - _startSample;
+
+            if (message.isPitchWheel())
+            {
+                const int position = juce::jlimit(0, _numSamples, samplePosition);
+                const float target = (float) (message.getPitchWheelValue() - 8192) / 8192.0f * pitchBendRange;
+
+                rampSemitones(bendPosition, position, bend, target);
+                bendPosition = position;
+                bend = target;
+                bendMoves = true;
+            }
+            else if (isNoteEvent(message))
+            {
+                noteEvents.addEvent(metadata.data, metadata.numBytes, samplePosition);
+            }
+            else if (message.isController())
+            {
+                setController(message.getChannel(), message.getControllerNumber(), message.getControllerValue());
+            }
+            else
+            {
+                noteEvents.addEvent(metadata.data, metadata.numBytes, 0);
+            }
+        }
+
+        for (int i = 0; i < numChangedControllers; i++)
+        {
+            const int index = changedControllers[(size_t) i];
+            noteEvents.addEvent(juce::MidiMessage::controllerEvent(index / 128 + 1, index % 128, controllerValues[(size_t) index]), 0);
+            controllerChanged[(size_t) index] = false;
+        }
+        numChangedControllers = 0;
+
+        bendActive = bendMoves || bend != 0.0f;
+        if (bendActive)
+        {
+            rampSemitones(bendPosition, _numSamples, bend, bend);
+
+            for (int i = 0; i < _numSamples; i++)
+                pitchBendRatio[(size_t) i] = FastMath::exp2<FastMath::normal>(semitones[(size_t) i] * (1.0f / 12.0f));
+        }
+
+        pitchBend = bend;
+    }
+
+    /// the note events of the block, to render with juce::Synthesiser::renderNextBlock()
+    const juce::MidiBuffer& getNoteEvents() const
+    {
+        return noteEvents;
+    }
+
+    /// frequency ratio of the pitch wheel for every sample of the block
+    /// @return const float*, nullptr when the wheel stays centred for the whole block
+    const float* getPitchBend() const
+    {
+        return bendActive ? pitchBendRatio.data() : nullptr;
+    }
+
+private:
+    /// true for the events that start or stop notes, they are rendered at their sample
+    static bool isNoteEvent(const juce::MidiMessage& _message)
+    {
+        if (_message.isNoteOnOrOff() || _message.isAllNotesOff() || _message.isAllSoundOff())
+            return true;
+
+        // sustain and sostenuto decide when released keys stop
+        return _message.isController() && (_message.getControllerNumber() == 64 || _message.getControllerNumber() == 66);
+    }
+
+    /// keep the last value of a controller in the block
+    /// @param int, MIDI channel 1 - 16
+    /// @param int, controller number
+    /// @param int, value
+    void setController(int _channel, int _number, int _value)
+    {
+        const int index = (_channel - 1) * 128 + _number;
+        controllerValues[(size_t) index] = _value;
+
+        if (!controllerChanged[(size_t) index])
+        {
+            controllerChanged[(size_t) index] = true;
+            changedControllers[(size_t) numChangedControllers++] = index;
+        }
+    }
+
+    /// interpolate the wheel position in semitones over [_start, _end)
+    void rampSemitones(int _start, int _end, float _from, float _to)
+    {
+        const float step = _end > _start ? (_to - _from) / (float) (_end - _start) : 0.0f;
+
+        for (int i = _start; i < _end; i++)
+            semitones[(size_t) i] = _from + step * (float) (i - _start);
+    }
+
+    juce::MidiBuffer noteEvents;
+    std::vector<float> semitones;
+    std::vector<float> pitchBendRatio;
+    std::array<int, numControllers> controllerValues {};        // last value in the block, by channel and number
+    std::array<bool, numControllers> controllerChanged {};
+    std::array<int, numControllers> changedControllers {};      // in the order they first changed
+    int numChangedControllers = 0;
+    float pitchBend = 0.0f;                          // wheel position at the end of the last block, semitones
+    bool bendActive = false;
+};
+
+#endif // MIDI_SCHEDULER_H
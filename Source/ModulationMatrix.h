@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    ModulationMatrix.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef MODULATION_MATRIX_H
+#define MODULATION_MATRIX_H
+
+#include <array>
+#include <JuceHeader.h>
+
+/// Routes modulation sources to destinations through a dense table of depths, one row per destination
+/// and one column per source. The table is compiled when the routing parameters change, into the list
+/// of its non-zero entries, and applied to a block of source values as one vectorised multiply-add per
+/// entry: the voices do not branch on the routing, per sample or per route.
+/// A new source or destination is a new column or row, the voices only provide or read its array.
+class ModulationMatrix
+{
+public:
+    enum Source
+    {
+        lfo1,
+        lfo2,
+        numSources
+    };
+
+    enum Destination
+    {
+        osc1Amp,
+        osc2Amp,
+        osc1Freq,                                   // Hz
+        osc2Freq,                                   // Hz
+        osc1Phase,                                  // cycles
+        osc2Phase,                                  // cycles
+        filterCutoff,                               // Hz
+        numDestinations
+    };
+
+    /// destination and depth of a choice of the "LFO1Destination"/"LFO2Destination" parameters
+    /// The LFO values span -amount to amount (0 - 100), the frequency depths give up to 500 Hz
+    /// on the oscillators and 700 Hz on the filter cutoff, the phase depths up to one cycle.
+    /// @param int, choice index
+    /// @param Destination&, routed destination
+    /// @param float&, depth in destination units per unit of LFO value
+    static void getLFORoute(int _choice, Destination& _destination, float& _depth)
+    {
+        static constexpr Destination destinations[] = { osc1Amp, osc2Amp, osc1Freq, osc2Freq, osc1Phase, osc2Phase, filterCutoff };
+        static constexpr float depths[] = { 1.0f, 1.0f, 5.0f, 5.0f, 0.01f, 0.01f, 7.0f };
+
+        const int choice = juce::jlimit(0, (int) std::size(destinations) - 1, _choice);
+        _destination = destinations[choice];
+        _depth = depths[choice];
+    }
+
+    /// remove every route
+    void clear()
+    {
+        for (auto& row : depths)
+            row.fill(0.0f);
+
+        numEntries = 0;
+    }
+
+    /// add a route, routes between the same source and destination add up
+    /// @param Source, modulation source
+    /// @param Destination, modulated destination
+    /// @param float, depth in destination units per unit of source
+    void addRoute(Source _source, Destination _destination, float _depth)
+    {
+        depths[(size_t) _destination][(size_t) _source] += _depth;
+        compile();
+    }
+
+    float getDepth(Source _source, Destination _destination) const
+    {
+        return depths[(size_t) _destination][(size_t) _source];
+    }
+
+    /// check if any source is routed to a destination
+    bool isModulated(Destination _destination) const
+    {
+        for (float depth : depths[(size_t) _destination])
+            if (depth != 0.0f)
+                return true;
+
+        return false;
+    }
+
+    /// compute the destination values of a block, destination = sum over sources of depth * source
+    /// Sources are added in source order, unmodulated destinations are zero.
+    /// @param const float* const*, numSources arrays of source values
+    /// @param float* const*, numDestinations arrays, overwritten
+    /// @param int, number of values
+    void process(const float* const* _sources, float* const* _destinations, int _numValues) const
+    {
+        for (int d = 0; d < numDestinations; d++)
+            juce::FloatVectorOperations::clear(_destinations[d], _numValues);
+
+        for (int i = 0; i < numEntries; i++)
+        {
+            const auto& entry = entries[(size_t) i];
+            juce::FloatVectorOperations::addWithMultiply(_destinations[entry.destination], _sources[entry.source], entry.depth, _numValues);
+        }
+    }
+
+private:
+    struct Entry
+    {
+        int destination = 0;
+        int source = 0;
+        float depth = 0.0f;
+    };
+
+    /// list the non-zero depths, by destination then source
+    void compile()
+    {
+        numEntries = 0;
+
+        for (int d = 0; d < numDestinations; d++)
+            for (int s = 0; s < numSources; s++)
+                if (depths[(size_t) d][(size_t) s] != 0.0f)
+                    entries[(size_t) numEntries++] = { d, s, depths[(size_t) d][(size_t) s] };
+    }
+
+    std::array<std::array<float, numSources>, numDestinations> depths {};
+    std::array<Entry, (int) numSources * (int) numDestinations> entries {};
+    int numEntries = 0;
+};
+
+#endif // MODULATION_MATRIX_H
@@ -4,6 +4,39 @@
 #include <cmath>         // for round()
 #include <variant>       // for std::variant
 #include "Oscillators.h" // for using Phasor class and its subclasses
+#include "Wavetable.h"   // for the band-limited waveshapes
+
+/// Audio-rate modulation of one main oscillator (the carrier) by the other (the modulator),
+/// chosen with the "OscCrossMod" parameter and scaled by "OscCrossModDepth".
+/// FM adds depth * carrier frequency * modulator sample to the carrier frequency,
+/// PM adds depth * modulator sample cycles to the carrier phase.
+struct CrossModulation
+{
+    enum Mode
+    {
+        off,
+        osc2FMOsc1,
+        osc2PMOsc1,
+        osc1FMOsc2,
+        osc1PMOsc2
+    };
+
+    static juce::StringArray getChoices()
+    {
+        return { "Off", "Osc2 FM Osc1", "Osc2 PM Osc1", "Osc1 FM Osc2", "Osc1 PM Osc2" };
+    }
+
+    /// index of the carrier (0 - Osc1, 1 - Osc2), the other oscillator is the modulator
+    static int getCarrier(int _mode)
+    {
+        return _mode == osc1FMOsc2 || _mode == osc1PMOsc2 ? 1 : 0;
+    }
+
+    static bool isPhaseModulation(int _mode)
+    {
+        return _mode == osc2PMOsc1 || _mode == osc1PMOsc2;
+    }
+};
 
 class OscSwitch
 {
@@ -21,6 +54,40 @@ public:
         return std::visit([](auto& os) { return os.process(); }, osc);
     }
 
+    /// render a block with the kernel selected by setWaveshape()
+    /// @param float*, destination
+    /// @param const float*, frequency offset for every sample, replaces setFreqOffset() for the block
+    /// @param int, number of samples
+    void process(float* _dest, const float* _freqOffsets, int _numSamples)
+    {
+        process(_dest, _freqOffsets, nullptr, _numSamples);
+    }
+
+    /// render a block with frequency and phase modulation
+    /// @param float*, destination
+    /// @param const float*, frequency offset for every sample in Hz, replaces setFreqOffset() for the block
+    /// @param const float*, phase offset for every sample in cycles, replaces setPhaseOffset() for the block, nullptr for none
+    /// @param int, number of samples
+    void process(float* _dest, const float* _freqOffsets, const float* _phaseOffsets, int _numSamples)
+    {
+        float ph = std::visit([](auto& os) { return os.getPhase(); }, osc);
+
+        if (wavetableShape >= 0 && wavetables != nullptr)
+        {
+            // mip level picked once per block from the frequency at its start
+            const float* table = wavetables->getTable(wavetableShape, freqbase + _freqOffsets[0]);
+            WavetableSet::processModulated(table, _dest, _numSamples, ph, freqbase, _freqOffsets, _phaseOffsets, sampleRate);
+        }
+        else
+        {
+            modulatedKernel(_dest, _numSamples, ph, freqbase, _freqOffsets, _phaseOffsets, sampleRate);
+        }
+
+        std::visit([ph](auto& os) { os.setPhase(ph); }, osc);
+
+        resetModulations();
+    }
+
     void setSampleRate(float _sampleRate)
     {
         jassert(_sampleRate > 0.0f);
@@ -30,6 +97,12 @@ public:
 
     void setWaveshape(int _waveshapeId)
     {
+        // Wavetable waveshapes render from the band-limited tables in the block path,
+        // the per-sample process() falls back to the matching naive oscillator
+        wavetableShape = WavetableSet::isWavetableWaveshape(_waveshapeId) ? _waveshapeId - WavetableSet::firstWaveshapeId : -1;
+        if (wavetableShape >= 0)
+            _waveshapeId = wavetableShape;
+
         switch (_waveshapeId)
         {
         case 0:
@@ -48,12 +121,21 @@ public:
             osc.emplace<SinOsc>(); // Default case
         }
 
+        modulatedKernel = OscKernels::getModulated(_waveshapeId);
+
         // Apply current settings to the new oscillator
         std::visit([this](auto& os) { os.setSampleRate(sampleRate); os.setFrequency(frequency); os.setPhase(phase); }, osc);
     }
 
 
 
+    /// use the band-limited tables shared by all voices
+    /// @param WavetableSet*, tables owned by the processor
+    void setWavetables(const WavetableSet* _wavetables)
+    {
+        wavetables = _wavetables;
+    }
+
     void setFrequency(float _frequency)
     {
         frequency = _frequency;
@@ -65,6 +147,11 @@ public:
         freqbase = _frequency;
     }
 
+    float getFreqBase() const
+    {
+        return freqbase;
+    }
+
     void setPhase(float _phase)
     {
         phase = _phase;
@@ -116,6 +203,9 @@ public:
 
 private:
     OscVariant osc; // Variant to hold any oscillator type
+    OscKernels::Modulated modulatedKernel = OscKernels::getModulated(0); // block kernel matching osc
+    const WavetableSet* wavetables = nullptr;
+    int wavetableShape = -1;                                             // table shape, -1 when a naive waveshape is selected
 
     float sampleRate = 0.0f;
     float frequency = 0.0f;
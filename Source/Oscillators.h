@@ -13,6 +13,15 @@
 
 #include <cmath>
 #include <JuceHeader.h>
+#include "FastMath.h"
+
+/// wrap a phase to [0, 1), for offsets of any sign and size (phase modulation)
+inline float wrapPhase(float p)
+{
+    p -= (float) (int) p;
+    return p < 0.0f ? p + 1.0f : p;
+}
+
 // PARENT phasor class
 class Phasor {
 public:
@@ -27,6 +36,10 @@ public:
         if (phase > 1.0f)
             phase -= 1.0f;
 
+        // phase modulation moves the read position, the running phase is left alone
+        if (phaseOffset != 0.0f)
+            return output(wrapPhase(phase + phaseOffset));
+
         return output(phase);
 
     }
@@ -45,7 +58,6 @@ public:
         frequency = freq;
         phaseDelta = frequency / sampleRate;
     }
-
     void setPhase(float ph)
     {
         phase = ph;
@@ -92,32 +104,74 @@ private:
 
 //==================================================
 
+// Waveshapes, shared by the oscillator classes below and the block kernels
+// the sine's accuracy is a template parameter, the audio oscillators play SinShape, the LFOs a cheaper tier
+template <FastMath::Accuracy accuracy>
+struct SineShape
+{
+    static float output(float p)
+    {
+        return FastMath::sin2Pi<accuracy>(p);
+    }
+};
+
+using SinShape = SineShape<FastMath::precise>;
+
+struct TriShape
+{
+    static float output(float p)
+    {
+        return fabsf(p - 0.5f) - 0.5f;
+    }
+};
+
+struct SawShape
+{
+    static float output(float p)
+    {
+        return p / juce::MathConstants<float>::pi;
+    }
+};
+
+struct SqrShape
+{
+    static float output(float p)
+    {
+        return p > 0.5f ? -0.5f : 0.5f;
+    }
+};
+
+//==================================================
+
 //   CHILD Class
 class TriOsc : public Phasor
 {
     float output(float p) override
     {
-        return fabsf(p - 0.5f) - 0.5f;
+        return TriShape::output(p);
     }
 };
 
 //   CHILD Class
 //==================================================
-class SinOsc : public Phasor
+template <FastMath::Accuracy accuracy = FastMath::precise>
+class BasicSinOsc : public Phasor
 {
     float output(float p) override
     {
-        return std::sin(p * 2.0 * 3.14159);
+        return SineShape<accuracy>::output(p);
     }
 };
 
+using SinOsc = BasicSinOsc<>;
+
 //   CHILD Class
 //==================================================
 class SawOsc : public Phasor
 {
     float output(float p) override
     {
-        return p / juce::MathConstants<float>::pi;
+        return SawShape::output(p);
     }
 };
 
@@ -140,4 +194,115 @@ public:
     float pulseWidth = 0.5f;
 private:
 };
+
+//==================================================
+
+// Modulated phase of a block, computed in passes so that only the running sum carries a dependency
+// from one sample to the next: the increments and the phase offsets are plain array operations
+// the compiler vectorises, and the waveshape is applied to the whole array afterwards.
+struct OscPhase
+{
+    /// write the phase of every sample of a block, the same phase update as Phasor::process()
+    /// @param float*, phase of every sample, in [0, 1]
+    /// @param int, number of samples
+    /// @param float&, running phase, advanced by the call
+    /// @param float, base frequency
+    /// @param const float*, frequency offset for every sample, the sum may go below zero (through-zero FM)
+    /// @param const float*, phase offset in cycles for every sample, nullptr for none
+    /// @param float, sample rate
+    static void processModulated(float* phases, int numSamples, float& phase, float freqBase, const float* freqOffsets, const float* phaseOffsets, float sampleRate)
+    {
+        for (int i = 0; i < numSamples; i++)
+            phases[i] = (freqBase + freqOffsets[i]) / sampleRate;
+
+        float p = phase;
+        for (int i = 0; i < numSamples; i++)
+        {
+            p += phases[i];
+            if (p > 1.0f)
+                p -= 1.0f;
+            else if (p < 0.0f)
+                p += 1.0f;
+            phases[i] = p;
+        }
+        phase = p;
+
+        if (phaseOffsets != nullptr)
+            for (int i = 0; i < numSamples; i++)
+                phases[i] = wrapPhase(phases[i] + phaseOffsets[i]);
+    }
+};
+
+// Block-rendering kernels
+// The waveshape is a template parameter, so a whole buffer is rendered with the waveshape inlined:
+// no std::variant dispatch and no virtual output() call per sample.
+// The phase update is the same as Phasor::process().
+template <typename Shape>
+struct OscKernel
+{
+    /// render a buffer at a fixed frequency
+    /// @param float*, destination
+    /// @param int, number of samples
+    /// @param float&, phase, advanced by the call
+    /// @param float, phase increment per sample (frequency / sampleRate)
+    static void process(float* dest, int numSamples, float& phase, float phaseDelta)
+    {
+        float p = phase;
+        for (int i = 0; i < numSamples; i++)
+        {
+            p += phaseDelta;
+            if (p > 1.0f)
+                p -= 1.0f;
+            dest[i] = Shape::output(p);
+        }
+        phase = p;
+    }
+
+    /// render a buffer with a frequency offset and a phase offset per sample (frequency and phase modulation)
+    /// @param float*, destination
+    /// @param int, number of samples
+    /// @param float&, phase, advanced by the call
+    /// @param float, base frequency
+    /// @param const float*, frequency offset for every sample
+    /// @param const float*, phase offset in cycles for every sample, nullptr for none
+    /// @param float, sample rate
+    static void processModulated(float* dest, int numSamples, float& phase, float freqBase, const float* freqOffsets, const float* phaseOffsets, float sampleRate)
+    {
+        OscPhase::processModulated(dest, numSamples, phase, freqBase, freqOffsets, phaseOffsets, sampleRate);
+
+        for (int i = 0; i < numSamples; i++)
+            dest[i] = Shape::output(dest[i]);
+    }
+};
+
+// Kernel lookup by waveshape id (0 - sine, 1 - triangle, 2 - saw, 3 - square),
+// done once when the waveshape changes, not per sample
+struct OscKernels
+{
+    using Fixed = void (*)(float*, int, float&, float);
+    using Modulated = void (*)(float*, int, float&, float, const float*, const float*, float);
+
+    template <FastMath::Accuracy sineAccuracy = FastMath::precise>
+    static Fixed getFixed(int waveshapeId)
+    {
+        switch (waveshapeId)
+        {
+        case 1:  return &OscKernel<TriShape>::process;
+        case 2:  return &OscKernel<SawShape>::process;
+        case 3:  return &OscKernel<SqrShape>::process;
+        default: return &OscKernel<SineShape<sineAccuracy>>::process;
+        }
+    }
+
+    static Modulated getModulated(int waveshapeId)
+    {
+        switch (waveshapeId)
+        {
+        case 1:  return &OscKernel<TriShape>::processModulated;
+        case 2:  return &OscKernel<SawShape>::processModulated;
+        case 3:  return &OscKernel<SqrShape>::processModulated;
+        default: return &OscKernel<SinShape>::processModulated;
+        }
+    }
+};
 #endif // Oscillators_h
\ No newline at end of file
@@ -0,0 +1,193 @@
+/*
+  ==============================================================================
+
+    ParallelVoiceRenderer.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef PARALLEL_VOICE_RENDERER_H
+#define PARALLEL_VOICE_RENDERER_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <JuceHeader.h>
+#include "SpinWait.h"
+#include "VoiceScratchArena.h"
+
+/// Renders the active voices of one block on a fixed pool of realtime worker threads.
+/// Every voice renders into its own block of the VoiceScratchArena, and the caller mixes the blocks
+/// in voice order afterwards, exactly as after serial rendering: the result is bit-identical.
+/// The audio thread takes part in the rendering and never waits on a lock or allocates: voices are
+/// claimed with a compare-and-swap on one atomic word, workers sleep on an atomic wait/notify.
+/// The workers are only started by start(), once the mode is switched on, so an instance that never
+/// renders in parallel holds no threads; until then render() leaves the voices to the caller.
+class ParallelVoiceRenderer
+{
+public:
+    static constexpr int maxVoices = 128;
+    static constexpr int maxWorkers = 8;
+
+    ~ParallelVoiceRenderer()
+    {
+        release();
+    }
+
+    /// stop the workers and keep the block size and sample rate for start() (prepareToPlay)
+    /// @param int, maximum block size
+    /// @param double, sample rate, used for the realtime thread scheduling hints
+    void prepare(int _maxBlockSize, double _sampleRate)
+    {
+        release();
+
+        maxBlockSize = _maxBlockSize;
+        sampleRate = _sampleRate;
+    }
+
+    /// start the workers if they are not running yet (message thread, or prepareToPlay), they run until release()
+    void start()
+    {
+        if (started.load(std::memory_order_acquire))
+            return;
+
+        const int numWorkers = juce::jlimit(0, maxWorkers, juce::SystemStats::getNumCpus() - 1);
+        for (int i = 0; i < numWorkers; i++)
+        {
+            workers.push_back(std::make_unique<Worker>(*this));
+            workers.back()->startRealtimeThread(juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime(maxBlockSize, sampleRate));
+        }
+
+        // the audio thread reads the workers only after this
+        started.store(true, std::memory_order_release);
+    }
+
+    /// true once start() has run, on a single core without any worker
+    bool isStarted() const
+    {
+        return started.load(std::memory_order_acquire);
+    }
+
+    /// stop the workers (releaseResources)
+    void release()
+    {
+        started.store(false, std::memory_order_release);
+
+        for (auto& worker : workers)
+            worker->signalThreadShouldExit();
+
+        wakeCounter.fetch_add(1, std::memory_order_release);
+        wakeCounter.notify_all();
+
+        for (auto& worker : workers)
+            worker->stopThread(1000);
+
+        workers.clear();
+    }
+
+    /// render every voice into its scratch block
+    /// @param MonoVoice* const*, active voices
+    /// @param float* const*, destination of each voice (its scratch block at the first sample)
+    /// @param int, number of voices
+    /// @param int, first sample
+    /// @param int, number of samples
+    /// @return bool, false if there are no workers, the caller then renders the voices itself
+    bool render(MonoVoice* const* _voices, float* const* _blocks, int _numVoices, int _startSample, int _numSamples)
+    {
+        if (!started.load(std::memory_order_acquire) || workers.empty() || _numVoices > maxVoices)
+            return false;
+
+        jobVoices = _voices;
+        jobBlocks = _blocks;
+        jobStart = _startSample;
+        jobLength = _numSamples;
+        jobsDone.store(0, std::memory_order_relaxed);
+
+        // publish the new job list: generation | count | next index
+        generation++;
+        jobState.store((generation << 16) | ((uint64_t) _numVoices << 8), std::memory_order_release);
+
+        wakeCounter.fetch_add(1, std::memory_order_release);
+        wakeCounter.notify_all();
+
+        // the audio thread claims every voice no worker has taken yet, a worker that has not woken up
+        // leaves all of them to it, so only the voices already being rendered are waited for
+        renderJobs();
+
+        SpinWait wait;
+        while (jobsDone.load(std::memory_order_acquire) < _numVoices)
+            wait.pause();
+
+        return true;
+    }
+
+private:
+    class Worker : public juce::Thread
+    {
+    public:
+        explicit Worker(ParallelVoiceRenderer& _owner) : juce::Thread("Voice Renderer"), owner(_owner) {}
+
+        void run() override
+        {
+            uint32_t seen = owner.wakeCounter.load(std::memory_order_acquire);
+
+            while (!threadShouldExit())
+            {
+                owner.wakeCounter.wait(seen, std::memory_order_acquire);
+                seen = owner.wakeCounter.load(std::memory_order_acquire);
+
+                if (threadShouldExit())
+                    break;
+
+                owner.renderJobs();
+            }
+        }
+
+    private:
+        ParallelVoiceRenderer& owner;
+    };
+
+    /// claim and render voices until all voices of the current job list are taken
+    void renderJobs()
+    {
+        uint64_t state = jobState.load(std::memory_order_acquire);
+
+        for (;;)
+        {
+            const int index = (int) (state & 0xff);
+            const int count = (int) ((state >> 8) & 0xff);
+
+            if (index >= count)
+                return;
+
+            // the generation bits make a claim from a stale job list fail
+            if (!jobState.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+                continue;
+
+            jobVoices[index]->renderMono(jobBlocks[index], jobStart, jobLength);
+
+            jobsDone.fetch_add(1, std::memory_order_acq_rel);
+            state = jobState.load(std::memory_order_acquire);
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> started { false };
+    int maxBlockSize = 512;
+    double sampleRate = 44100.0;
+
+    // current job list, written by the audio thread before it is published through jobState
+    MonoVoice* const* jobVoices = nullptr;
+    float* const* jobBlocks = nullptr;
+    int jobStart = 0;
+    int jobLength = 0;
+
+    uint64_t generation = 0;
+    std::atomic<uint64_t> jobState { 0 };
+    std::atomic<int> jobsDone { 0 };
+    std::atomic<uint32_t> wakeCounter { 0 };
+};
+
+#endif // PARALLEL_VOICE_RENDERER_H
@@ -11,15 +11,53 @@
 
 //==============================================================================
 PolyphonicSynthAudioProcessorEditor::PolyphonicSynthAudioProcessorEditor (PolyphonicSynthAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p), parameterEditor (p)
 {
+    addAndMakeVisible (parameterEditor);
+
+    impulseResponseButton.onClick = [this] { chooseImpulseResponse(); };
+    updateImpulseResponseButton();
+    addAndMakeVisible (impulseResponseButton);
+
+    presetBankButton.onClick = [this] { choosePresetBank(); };
+    previousPresetButton.onClick = [this] { stepPreset (-1); };
+    nextPresetButton.onClick = [this] { stepPreset (1); };
+    updatePresetBankButton();
+    addAndMakeVisible (presetBankButton);
+    addAndMakeVisible (previousPresetButton);
+    addAndMakeVisible (nextPresetButton);
+
+    if (DspProfiler::isEnabled)
+    {
+        // the timing costs nothing on the audio thread until it is switched on here (Release builds)
+        profileButton.setToggleState (audioProcessor.getProfiler().isActive(), juce::dontSendNotification);
+        profileButton.onClick = [this]
+        {
+            audioProcessor.getProfiler().setActive (profileButton.getToggleState());
+        };
+
+        const auto file = juce::File::getSpecialLocation (juce::File::userDocumentsDirectory).getChildFile ("PolyphonicSynth DSP profile.csv");
+        dumpButton.setTooltip ("Writes the timings of every block to " + file.getFullPathName());
+        dumpButton.onClick = [this, file]
+        {
+            audioProcessor.getProfiler().setDumpFile (dumpButton.getToggleState() ? file : juce::File());
+        };
+
+        addAndMakeVisible (profileButton);
+        addAndMakeVisible (dumpButton);
+    }
+
+    // the presets are loaded in the background, the timer also picks up their names
+    startTimerHz (4);
+
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    setSize (juce::jmax (400, parameterEditor.getWidth()), parameterEditor.getHeight() + buttonRowHeight + readoutHeight);
 }
 
 PolyphonicSynthAudioProcessorEditor::~PolyphonicSynthAudioProcessorEditor()
 {
+    audioProcessor.getProfiler().setDumpFile ({});
 }
 
 //==============================================================================
@@ -28,13 +66,126 @@ void PolyphonicSynthAudioProcessorEditor::paint (juce::Graphics& g)
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
 
+    if (DspProfiler::isEnabled)
+        paintReadout (g, getLocalBounds().withTrimmedBottom (buttonRowHeight).removeFromBottom (readoutHeight).reduced (8, 4));
+}
+
+void PolyphonicSynthAudioProcessorEditor::paintReadout (juce::Graphics& g, juce::Rectangle<int> area) const
+{
     g.setColour (juce::Colours::white);
-    g.setFont (15.0f);
-    g.drawFittedText ("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
+    g.setFont (juce::Font (juce::Font::getDefaultMonospacedFontName(), 13.0f, juce::Font::plain));
+
+    auto drawRow = [&g, &area] (const juce::String& text)
+    {
+        g.drawText (text, area.removeFromTop (rowHeight), juce::Justification::centredLeft, false);
+    };
+
+    if (statistics.numFrames == 0)
+    {
+        drawRow (audioProcessor.getProfiler().isActive() ? "DSP load: waiting for audio" : "DSP load: switch on Profile to time the blocks");
+        return;
+    }
+
+    const auto& load = statistics.load;
+    drawRow (juce::String::formatted ("DSP load  avg %.1f%%  p99 %.1f%%  max %.1f%%  voices %.1f  dropped %d",
+                                      load.average, load.p99, load.max, statistics.averageVoices, (int) statistics.droppedFrames));
+    area.removeFromTop (rowHeight / 2);
+
+    auto formatRow = [] (const char* name, const DspProfiler::Range& range)
+    {
+        return juce::String::formatted ("%-12s %9.1f %9.1f %9.1f %9.1f", name, range.min, range.average, range.p99, range.max);
+    };
+
+    drawRow (juce::String::formatted ("%-12s %9s %9s %9s %9s", "stage (us)", "min", "avg", "p99", "max"));
+    for (int stage = 0; stage < DspStage::numStages; stage++)
+        drawRow (formatRow (DspStage::getName (stage), statistics.stages[(size_t) stage]));
+    drawRow (formatRow ("Max voice", statistics.voice));
 }
 
 void PolyphonicSynthAudioProcessorEditor::resized()
 {
     // This is generally where you'll want to lay out the positions of any
     // subcomponents in your editor..
+    auto area = getLocalBounds();
+    auto buttonRow = area.removeFromBottom (buttonRowHeight);
+    impulseResponseButton.setBounds (buttonRow.removeFromLeft (buttonRow.getWidth() / 2).reduced (4, 2));
+    nextPresetButton.setBounds (buttonRow.removeFromRight (buttonRowHeight).reduced (2));
+    previousPresetButton.setBounds (buttonRow.removeFromRight (buttonRowHeight).reduced (2));
+    presetBankButton.setBounds (buttonRow.reduced (4, 2));
+    auto readout = area.removeFromBottom (readoutHeight);
+    parameterEditor.setBounds (area);
+
+    auto toggleRow = readout.removeFromBottom (rowHeight + 8);
+    profileButton.setBounds (toggleRow.removeFromLeft (toggleRow.getWidth() / 3).reduced (4, 2));
+    dumpButton.setBounds (toggleRow.reduced (4, 2));
+}
+
+void PolyphonicSynthAudioProcessorEditor::chooseImpulseResponse()
+{
+    impulseResponseChooser = std::make_unique<juce::FileChooser> ("Load an impulse response",
+                                                                  audioProcessor.getConvolutionReverb().getImpulseResponseFile(),
+                                                                  "*.wav;*.aif;*.aiff");
+
+    impulseResponseChooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                                         [this] (const juce::FileChooser& chooser)
+    {
+        const auto file = chooser.getResult();
+        if (file.existsAsFile())
+        {
+            audioProcessor.loadImpulseResponse (file);
+            updateImpulseResponseButton();
+        }
+    });
+}
+
+void PolyphonicSynthAudioProcessorEditor::updateImpulseResponseButton()
+{
+    const auto& file = audioProcessor.getConvolutionReverb().getImpulseResponseFile();
+    impulseResponseButton.setButtonText (file == juce::File() ? juce::String ("Load IR...") : "IR: " + file.getFileName());
+}
+
+void PolyphonicSynthAudioProcessorEditor::choosePresetBank()
+{
+    presetBankChooser = std::make_unique<juce::FileChooser> ("Open a preset bank",
+                                                             audioProcessor.getPresetLibrary().getBankFile(),
+                                                             "*.psbank");
+
+    presetBankChooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                                    [this] (const juce::FileChooser& chooser)
+    {
+        const auto file = chooser.getResult();
+        if (file.existsAsFile())
+            audioProcessor.getPresetLibrary().openBank (file);
+    });
+}
+
+void PolyphonicSynthAudioProcessorEditor::updatePresetBankButton()
+{
+    const auto bank = audioProcessor.getPresetLibrary().getBank();
+    const auto text = bank == nullptr ? juce::String ("Open Bank...")
+                                      : bank->getFile().getFileNameWithoutExtension() + ": " + audioProcessor.getProgramName (audioProcessor.getCurrentProgram());
+
+    if (presetBankButton.getButtonText() != text)
+        presetBankButton.setButtonText (text);
+}
+
+void PolyphonicSynthAudioProcessorEditor::stepPreset (int steps)
+{
+    const auto bank = audioProcessor.getPresetLibrary().getBank();
+    if (bank == nullptr || bank->getNumPresets() == 0)
+        return;
+
+    const int numPresets = bank->getNumPresets();
+    audioProcessor.setCurrentProgram (((audioProcessor.getCurrentProgram() + steps) % numPresets + numPresets) % numPresets);
+}
+
+void PolyphonicSynthAudioProcessorEditor::timerCallback()
+{
+    updatePresetBankButton();
+
+    if (DspProfiler::isEnabled)
+    {
+        statistics = audioProcessor.getProfiler().getStatistics();
+        repaint (getLocalBounds().withTrimmedBottom (buttonRowHeight).removeFromBottom (readoutHeight));
+    }
 }
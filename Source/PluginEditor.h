@@ -12,9 +12,12 @@
 #include "PluginProcessor.h"
 
 //==============================================================================
-/**
+/** The generic parameter editor with the DSP load readout of the profiler below it,
+    a button to load the impulse response of the convolution reverb, and the preset bank:
+    a button to open one and buttons to step through its presets.
 */
-class PolyphonicSynthAudioProcessorEditor  : public juce::AudioProcessorEditor
+class PolyphonicSynthAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                             private juce::Timer
 {
 public:
     PolyphonicSynthAudioProcessorEditor (PolyphonicSynthAudioProcessor&);
@@ -25,9 +28,40 @@ public:
     void resized() override;
 
 private:
+    void timerCallback() override;
+
+    /// draw the statistics of the profiler as a table, one row per stage
+    void paintReadout (juce::Graphics&, juce::Rectangle<int>) const;
+
+    /// ask for an impulse response file, the processor loads it in the background
+    void chooseImpulseResponse();
+    void updateImpulseResponseButton();
+
+    /// ask for a preset bank file, the library opens it in the background
+    void choosePresetBank();
+    void updatePresetBankButton();
+
+    /// load the preset a number of steps away from the current one, wrapping around the bank
+    void stepPreset (int steps);
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     PolyphonicSynthAudioProcessor& audioProcessor;
 
+    juce::GenericAudioProcessorEditor parameterEditor;
+    juce::ToggleButton profileButton { "Profile" };
+    juce::ToggleButton dumpButton { "Log timings to file" };
+    juce::TextButton impulseResponseButton;
+    std::unique_ptr<juce::FileChooser> impulseResponseChooser;
+    juce::TextButton presetBankButton;
+    juce::TextButton previousPresetButton { "<" };
+    juce::TextButton nextPresetButton { ">" };
+    std::unique_ptr<juce::FileChooser> presetBankChooser;
+    DspProfiler::Statistics statistics;
+
+    static constexpr int rowHeight = 16;
+    static constexpr int buttonRowHeight = rowHeight + 8;
+    static constexpr int readoutHeight = DspProfiler::isEnabled ? (DspStage::numStages + 6) * rowHeight : 0;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PolyphonicSynthAudioProcessorEditor)
 };
@@ -27,9 +27,37 @@ apvts(*this, nullptr, "ParameterTree", createParameterLayout())
 
 
 {
-    reverbon = apvts.getRawParameterValue("Reverb");
+    // the audio thread reads the values of the block, a restored preset replaces them all at once
+    presets.attach(*this, apvts);
+    parameters.attach(presets);
+    reverbon = presets.getRawParameterValue("Reverb");
+    reverbTypeParam = presets.getRawParameterValue("ReverbType");
+    polyphonyParam = presets.getRawParameterValue("Polyphony");
+    parallelVoicesParam = presets.getRawParameterValue("ParallelVoices");
+    minSubBlockParam = presets.getRawParameterValue("MinSubBlock");
+
+    // presets of a bank are parsed on the library's thread and applied here, on the message thread
+    library.onBankOpened = [this]
+    {
+        currentProgram = 0;
+        updateHostDisplay();
+    };
+    library.onPresetLoaded = [this](int index, std::unique_ptr<PresetState> preset)
+    {
+        currentProgram = index;
+        applyPreset(std::move(preset));
+    };
+    releaseParams[0] = apvts.getRawParameterValue("release1");
+    releaseParams[1] = apvts.getRawParameterValue("release2");
+    reverbTreeParams[0] = apvts.getRawParameterValue("Reverb");
+    reverbTreeParams[1] = apvts.getRawParameterValue("ReverbType");
+    modeTreeParams[0] = apvts.getRawParameterValue("ParallelVoices");
+    modeTreeParams[1] = apvts.getRawParameterValue("PipelinedReverb");
 
     synth.addSound(new synthSound());
+    synth.setProfiler(&profiler);
+    synth.setVoiceBank(&voiceBank);
+    voiceBank.setParameters(&parameters.get());
 
     for (int i = 0; i < voicecount; i++)
         synth.addVoice(new synthVoice());
@@ -37,12 +65,21 @@ apvts(*this, nullptr, "ParameterTree", createParameterLayout())
     for (int i = 0; i < synth.getNumVoices(); i++)
     {
         auto voice = dynamic_cast  <synthVoice*>(synth.getVoice(i));
-        voice->setParametersFromApvts(apvts);
+        voice->setParameters(&parameters.get());
+        voice->setVoiceBank(voiceBank, i);
+        voice->setFilterCoefficientCache(&filterCoefficients);
+        voice->setWavetables(&wavetables);
     }
+
+    startTimerHz(10);
 }
 
 PolyphonicSynthAudioProcessor::~PolyphonicSynthAudioProcessor()
 {
+    stopTimer();
+
+    // the pipeline's worker calls processReverb, stop it before the parameters and the reverbs are destroyed
+    reverbPipeline.release();
 }
 
 //==============================================================================
@@ -80,27 +117,86 @@ bool PolyphonicSynthAudioProcessor::isMidiEffect() const
 
 double PolyphonicSynthAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // the longest envelope release after the last note off, then the reverb's decay
+    // The host asks between blocks too, the values come from the parameter tree rather than the block.
+    const double release = juce::jmax(releaseParams[0]->load(), releaseParams[1]->load());
+    if (*reverbTreeParams[0] != true)
+        return release;
+
+    if ((int) *reverbTreeParams[1] == 1 && convolutionReverb.isReady())
+        return release + (getSampleRate() > 0.0 ? convolutionReverb.getTailSamples() / getSampleRate() : 0.0);
+
+    return release + reverbTailSeconds;
+}
+
+bool PolyphonicSynthAudioProcessor::isConvolutionReverbActive() const
+{
+    return (int) *reverbTypeParam == 1 && convolutionReverb.isReady();
+}
+
+void PolyphonicSynthAudioProcessor::updateModes()
+{
+    if (!prepared)
+        return;
+
+    if (*modeTreeParams[0] == true)
+        parallelRenderer.start();
+
+    if (*reverbTreeParams[0] == true && (int) *reverbTreeParams[1] == 1)
+        convolutionReverb.start();
+
+    // the pipeline's worker runs before the audio thread switches to it, the host learns the new latency
+    // here and the audio thread applies the mode at its next block
+    const bool pipelined = *modeTreeParams[1] == true;
+    if (pipelined)
+        reverbPipeline.start();
+
+    if (pipelined != reverbPipelined.load(std::memory_order_relaxed))
+    {
+        setLatencySamples(pipelined ? reverbPipeline.getLatencySamples() : 0);
+        reverbPipelined.store(pipelined, std::memory_order_release);
+    }
+}
+
+void PolyphonicSynthAudioProcessor::timerCallback()
+{
+    updateModes();
+}
+
+double PolyphonicSynthAudioProcessor::getReverbTailSeconds(const juce::Reverb::Parameters& reverbParams, double sampleRate)
+{
+    // juce::Reverb's combs feed back roomSize * 0.28 + 0.7 (less damping) once per delay line length,
+    // the comb delays are fixed in samples because the reverb is left at its default sample rate
+    const double feedback = reverbParams.roomSize * 0.28 + 0.7;
+    const double loops = std::log(silenceThreshold) / std::log(feedback);
+    return loops * reverbLoopSamples / sampleRate;
 }
 
 int PolyphonicSynthAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    // the presets of the open bank
+    // NB: some hosts don't cope very well if you tell them there are 0 programs,
+    // so this should be at least 1, even if you're not really implementing programs.
+    const auto bank = library.getBank();
+    return bank != nullptr ? juce::jmax(1, bank->getNumPresets()) : 1;
 }
 
 int PolyphonicSynthAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram;
 }
 
 void PolyphonicSynthAudioProcessor::setCurrentProgram (int index)
 {
+    // loaded in the background, the program changes once the preset is applied
+    library.loadPreset(index);
 }
 
 const juce::String PolyphonicSynthAudioProcessor::getProgramName (int index)
 {
-    return {};
+    // hosts ask from their own threads, the reference keeps the bank mapped while its name is read
+    const auto bank = library.getBank();
+    return bank != nullptr && juce::isPositiveAndBelow(index, bank->getNumPresets()) ? bank->getName(index) : juce::String();
 }
 
 void PolyphonicSynthAudioProcessor::changeProgramName (int index, const juce::String& newName)
@@ -110,7 +206,29 @@ void PolyphonicSynthAudioProcessor::changeProgramName (int index, const juce::St
 //==============================================================================
 void PolyphonicSynthAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    filterCoefficients.prepare(sampleRate);
+    wavetables.prepare(sampleRate);
     synth.setCurrentPlaybackSampleRate(sampleRate);
+    preparedBlockSize = juce::jmax(1, samplesPerBlock);
+    // the smoothers start from the values the first block reads, not from the ones at construction
+    presets.beginBlock();
+    parameters.prepare(sampleRate, samplesPerBlock);
+    midiScheduler.prepare(samplesPerBlock);
+    voiceScratch.prepare(synth.getNumVoices(), samplesPerBlock);
+    voiceBank.setBlockStride(voiceScratch.getStride());
+    synth.setScratchArena(&voiceScratch);
+    parallelRenderer.prepare(samplesPerBlock, sampleRate);
+    profiler.prepare(sampleRate);
+    convolutionReverb.prepare(samplesPerBlock, sampleRate);
+    reverbPipeline.prepare(samplesPerBlock, sampleRate, [this](float* left, float* right, int numSamples, bool inputSilent)
+    {
+        processReverb(left, right, numSamples, inputSilent);
+    });
+    reverbPipelined.store(*modeTreeParams[1] == true, std::memory_order_relaxed);
+    reverbPipelineActive = reverbPipelined.load(std::memory_order_relaxed);
+    setLatencySamples(reverbPipelineActive ? reverbPipeline.getLatencySamples() : 0);
+    prepared = true;
+    updateModes();
 
     juce::Reverb::Parameters reverbParams;
     reverbParams.dryLevel = 0.5f;
@@ -119,12 +237,20 @@ void PolyphonicSynthAudioProcessor::prepareToPlay (double sampleRate, int sample
 
     reverb.setParameters(reverbParams);
     reverb.reset();
+    reverbTailActive = false;
+    reverbSilentSamples = 0;
+    reverbTailSeconds = getReverbTailSeconds(reverbParams, sampleRate);
 }
 
 void PolyphonicSynthAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    prepared = false;
+    parallelRenderer.release();
+    profiler.release();
+    reverbPipeline.release();
+    convolutionReverb.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -156,6 +282,7 @@ bool PolyphonicSynthAudioProcessor::isBusesLayoutSupported (const BusesLayout& l
 void PolyphonicSynthAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -168,20 +295,119 @@ void PolyphonicSynthAudioProcessor::processBlock (juce::AudioBuffer<float>& buff
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
+    // the per-sample buffers are sized in prepareToPlay, a longer block than the host announced
+    // is rendered in parts of the prepared size rather than growing them on the audio thread
+    const int totalNumSamples = buffer.getNumSamples();
+
+    for (int start = 0; start < totalNumSamples; start += preparedBlockSize)
+    {
+        const int partSamples = juce::jmin(preparedBlockSize, totalNumSamples - start);
+        juce::AudioBuffer<float> part(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, partSamples);
+        processPart(part, midiMessages, start, start + partSamples == totalNumSamples);
+    }
+}
+
+void PolyphonicSynthAudioProcessor::processPart(juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midiMessages, int startSample, bool lastPart)
+{
+    profiler.beginBlock();
+    presets.beginBlock();
+
     // For reverb and delay
     int numSamples = buffer.getNumSamples();
     // pointers to audio arrays
     float* leftChannel = buffer.getWritePointer(0); //int channelNumber
     float* rightChannel = buffer.getWritePointer(1);
 
-    synth.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
+    // one read of every voice parameter per block, shared by all voices
+    parameters.update(numSamples);
+
+    // only note events split the voice rendering, pitch bend reaches the voices as a ramp
+    midiScheduler.schedule(midiMessages, startSample, numSamples, lastPart);
+    parameters.setPitchBend(midiScheduler.getPitchBend());
+    const auto& noteEvents = midiScheduler.getNoteEvents();
+
+    synth.setPolyphony((int) *polyphonyParam);
+    // a mode switched on since the last block starts its threads on the message thread,
+    // its work runs on the audio thread until they are ready
+    synth.setParallelRenderer(*parallelVoicesParam == true && parallelRenderer.isStarted() ? &parallelRenderer : nullptr);
+    synth.setMinimumRenderingSubdivisionSize(MidiScheduler::getMinimumSubBlockSize((int) *minSubBlockParam), false);
+    // with no voice sounding and no MIDI the synth output is exactly silent, the voice loop is skipped
+    const bool synthIdle = noteEvents.isEmpty() && !synth.hasActiveVoices();
+    if (!synthIdle)
+        synth.renderNextBlock(buffer, noteEvents, 0, buffer.getNumSamples());
+    profiler.lap(DspStage::voices);
+
+    // the mode the message thread published with the new latency is taken at a block boundary,
+    // the samples in flight are dropped
+    const bool pipelined = reverbPipelined.load(std::memory_order_acquire);
+    if (pipelined != reverbPipelineActive)
+    {
+        reverbPipelineActive = pipelined;
+        reverbPipeline.reset();
+    }
+
+    if (pipelined)
+        reverbPipeline.process(leftChannel, rightChannel, numSamples, synthIdle);
+    else
+        processReverb(leftChannel, rightChannel, numSamples, synthIdle);
+    profiler.lap(DspStage::reverb);
 
+    profiler.endBlock(numSamples);
+}
+
+void PolyphonicSynthAudioProcessor::processReverb(float* left, float* right, int numSamples, bool inputSilent)
+{
     if (*reverbon == true)
     {
-        reverb.processStereo(leftChannel, rightChannel, numSamples);
+        if (!inputSilent)
+        {
+            reverbTailActive = true;
+            reverbSilentSamples = 0;
+        }
+
+        if (reverbTailActive && isConvolutionReverbActive())
+        {
+            convolutionReverb.processStereo(left, right, numSamples);
+
+            // the convolution output and state are exactly zero once the silent input has passed through the whole response
+            reverbSilentSamples = inputSilent ? reverbSilentSamples + numSamples : 0;
+            if (reverbSilentSamples >= convolutionReverb.getTailSamples())
+                reverbTailActive = false;
+        }
+        else if (reverbTailActive)
+        {
+            // once the input is silent, the tail runs until its output has stayed below the threshold
+            // for a whole comb delay, the reverb state is then inaudible and is cleared
+            reverb.processStereo(left, right, numSamples);
+
+            if (inputSilent && getMagnitude(left, right, numSamples) < silenceThreshold)
+            {
+                reverbSilentSamples += numSamples;
+                if (reverbSilentSamples >= reverbLoopSamples)
+                {
+                    reverb.reset();
+                    reverbTailActive = false;
+                }
+            }
+            else
+            {
+                reverbSilentSamples = 0;
+            }
+        }
     }
+}
 
+float PolyphonicSynthAudioProcessor::getMagnitude(const float* left, const float* right, int numSamples)
+{
+    const auto rangeLeft = juce::FloatVectorOperations::findMinAndMax(left, numSamples);
+    const auto rangeRight = juce::FloatVectorOperations::findMinAndMax(right, numSamples);
+    return juce::jmax(-rangeLeft.getStart(), rangeLeft.getEnd(), -rangeRight.getStart(), rangeRight.getEnd());
+}
 
+void PolyphonicSynthAudioProcessor::loadImpulseResponse(const juce::File& file)
+{
+    convolutionReverb.loadImpulseResponse(file);
+    apvts.state.setProperty("ImpulseResponse", file.getFullPathName(), nullptr);
 }
 
 //==============================================================================
@@ -192,33 +418,52 @@ bool PolyphonicSynthAudioProcessor::hasEditor() const
 
 juce::AudioProcessorEditor* PolyphonicSynthAudioProcessor::createEditor()
 {
-    //return new PolyphonicSynthAudioProcessorEditor (*this);
-    return new juce::GenericAudioProcessorEditor(*this);
+    return new PolyphonicSynthAudioProcessorEditor (*this);
 }
 
 //==============================================================================
 void PolyphonicSynthAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-    auto state = apvts.copyState();
-    std::unique_ptr<juce::XmlElement> xml(state.createXml());
-    copyXmlToBinary(*xml, destData);
+    // a binary chunk of the parameter values, restored without parsing the XML of the parameter tree
+    presets.writeBinary(destData, apvts.state.getProperty("ImpulseResponse").toString(), library.getBankFile().getFullPathName());
 }
 
 void PolyphonicSynthAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
-    std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
-    if (xmlState.get() != nullptr)
+    // the binary chunk of getStateInformation(), or the XML saved by earlier versions
+    std::unique_ptr<PresetState> preset;
+
+    if (PresetSwap::isBinary(data, sizeInBytes))
     {
-        if (xmlState->hasTagName(apvts.state.getType()))
-        {
-            apvts.replaceState(juce::ValueTree::fromXml(*xmlState));
-        }
+        preset = presets.readBinary(data, sizeInBytes);
+    }
+    else
+    {
+        std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
+        if (xmlState.get() != nullptr && xmlState->hasTagName(apvts.state.getType()))
+            preset = presets.readXml(*xmlState);
     }
+
+    if (preset == nullptr)
+        return;
+
+    // the bank is opened in the background, its presets are not needed to restore the state
+    if (preset->presetBank.isNotEmpty() && juce::File(preset->presetBank) != library.getBankFile())
+        library.openBank(juce::File(preset->presetBank));
+
+    applyPreset(std::move(preset));
+}
+
+void PolyphonicSynthAudioProcessor::applyPreset(std::unique_ptr<PresetState> preset)
+{
+    const auto impulseResponse = preset->impulseResponse;
+    apvts.state.setProperty("ImpulseResponse", impulseResponse, nullptr);
+
+    // the audio thread switches to the whole preset at its next block
+    presets.load(std::move(preset));
+
+    if (impulseResponse.isNotEmpty() && juce::File(impulseResponse) != convolutionReverb.getImpulseResponseFile())
+        convolutionReverb.loadImpulseResponse(juce::File(impulseResponse));
 }
 
 //==============================================================================
@@ -9,11 +9,17 @@
 #pragma once
 #include <JuceHeader.h>
 #include "Synth.h"
+#include "ConvolutionReverb.h"
+#include "ReverbPipeline.h"
+#include "MidiScheduler.h"
+#include "PresetState.h"
+#include "PresetLibrary.h"
 
 //==============================================================================
 /**
 */
-class PolyphonicSynthAudioProcessor  : public juce::AudioProcessor
+class PolyphonicSynthAudioProcessor  : public juce::AudioProcessor,
+                                       private juce::Timer
 {
 public:
     //==============================================================================
@@ -53,12 +59,90 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    //==============================================================================
+    /// stage timings of the audio thread, shown by the editor
+    DspProfiler& getProfiler() { return profiler; }
+
+    /// load the impulse response of the "Convolution" reverb type in the background, it is saved with the state
+    /// @param juce::File, WAV or AIFF file
+    void loadImpulseResponse(const juce::File&);
+
+    ConvolutionReverb& getConvolutionReverb() { return convolutionReverb; }
+
+    /// preset banks, their presets are the programs of the plugin
+    PresetLibrary& getPresetLibrary() { return library; }
+
 private:
-    juce::Synthesiser synth;
-    int voicecount = 4;
+    synthEngine synth;
+    int voicecount = synthEngine::maxVoices;      // voices allocated up front, "Polyphony" limits how many are used
     juce::Reverb reverb;
+    ConvolutionReverb convolutionReverb;           // "Convolution" reverb type, once an impulse response is loaded
+    ReverbPipeline reverbPipeline;                 // runs processReverb one block behind on a worker, "PipelinedReverb" mode
+    std::atomic<bool> reverbPipelined { false };   // mode set on the message thread with the latency reported to the host
+    bool reverbPipelineActive = false;             // mode of the last block, follows reverbPipelined at a block boundary
+    bool prepared = false;                         // between prepareToPlay and releaseResources, the workers may run
+    FilterCoefficientCache filterCoefficients;     // shared by all voices
+    WavetableSet wavetables;                       // shared by all voices
+    VoiceScratchArena voiceScratch;                // mono render blocks of every voice, allocated in prepareToPlay
+    VoiceBank voiceBank { synthEngine::maxVoices };   // envelopes, mix and filter of all voices, a SIMD register of voices at a time
+    ParallelVoiceRenderer parallelRenderer;        // worker threads for the "ParallelVoices" mode
+    PresetSwap presets;                            // parameter values of the block, state format and preset switching
+    PresetLibrary library { presets };             // preset bank, opened and read on its own thread
+    std::atomic<int> currentProgram { 0 };          // preset of the bank last loaded, read by the host from any thread
+    ParameterSnapshot parameters;                  // voice parameters, read once per block
+    MidiScheduler midiScheduler;                   // keeps controller events from splitting the voice blocks
+    DspProfiler profiler;                          // stage timings, switched on from the editor, compiled out with POLYSYNTH_PROFILING=0
 
     std::atomic<float>* reverbon;
+    std::atomic<float>* reverbTypeParam;
+    std::atomic<float>* releaseParams[2];          // parameter tree values, for the host's tail length queries
+    std::atomic<float>* modeTreeParams[2];         // parameter tree values of ParallelVoices and PipelinedReverb, for updateModes()
+    std::atomic<float>* reverbTreeParams[2];
+
+    // Silence and tail detection
+    static constexpr float silenceThreshold = 1.0e-5f;              // -100 dBFS
+    static constexpr int reverbLoopSamples = 1617 + 23;            // longest comb of juce::Reverb, right channel
+    std::atomic<bool> reverbTailActive { false };                   // reverb output not yet below the threshold, set by the reverb thread
+    int reverbSilentSamples = 0;                                    // reverb output (convolution: input) samples below the threshold
+    double reverbTailSeconds = 0.0;
+    int preparedBlockSize = 512;                                    // largest part processBlock renders at once, from prepareToPlay
+
+    /// time for the reverb tail to decay below the silence threshold
+    static double getReverbTailSeconds(const juce::Reverb::Parameters&, double sampleRate);
+
+    /// true when the "Convolution" reverb type is selected and has an impulse response
+    bool isConvolutionReverbActive() const;
+
+    /// start the worker threads of the modes that are switched on and switch the reverb pipeline with the latency
+    /// reported to the host (message thread); a mode that is never switched on never starts its threads, a started
+    /// one keeps them until releaseResources(). The audio thread only reads the flags this publishes.
+    void updateModes();
+
+    /// render a part of the host's block no longer than the prepared block size
+    /// @param juce::AudioBuffer<float>&, the samples of the part
+    /// @param const juce::MidiBuffer&, the host's MIDI for the whole block
+    /// @param int, first sample of the part in the host's block
+    /// @param bool, true for the part that ends the host's block
+    void processPart(juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midiMessages, int startSample, bool lastPart);
+
+    /// the reverb stage with its silence detection, on the audio thread or on the pipeline's worker
+    /// @param float*, left channel
+    /// @param float*, right channel
+    /// @param int, number of samples
+    /// @param bool, true if the synth output of the block is digital silence
+    void processReverb(float* left, float* right, int numSamples, bool inputSilent);
+
+    /// restore a preset, from the state or from the bank (message thread)
+    void applyPreset(std::unique_ptr<PresetState>);
+
+    /// the largest absolute sample value of a stereo block
+    static float getMagnitude(const float* left, const float* right, int numSamples);
+
+    /// follows the mode parameters, which the host may change from any thread
+    void timerCallback() override;
+    std::atomic<float>* polyphonyParam;
+    std::atomic<float>* parallelVoicesParam;
+    std::atomic<float>* minSubBlockParam;
 
 
     //UI
@@ -67,7 +151,7 @@ private:
     {
         juce::AudioProcessorValueTreeState::ParameterLayout layout;
         // Osc1
-        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("Osc1Waveshape", 1), "Osc1", juce::StringArray{ "Sine", "Triangle", "Saw", "Square"}, 0));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("Osc1Waveshape", 1), "Osc1", juce::StringArray{ "Sine", "Triangle", "Saw", "Square", "Sine (WT)", "Triangle (WT)", "Saw (WT)", "Square (WT)"}, 0));
         layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("Osc1Unison", 1), "Unison", juce::StringArray{ "None", "2", "3", "4", "5", "6", "7", "8" }, 0));
         layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("Osc1Detune", 1), "Detune(%)", 0.0, 100, 20));
         layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("level1", 1), "Level", 0.0, 1, 0.5));
@@ -78,7 +162,7 @@ private:
         layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("release1", 1), "Release", 0.0, 5, 0.5));
 
         // Osc2
-        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("Osc2Waveshape", 1), "Osc2", juce::StringArray{ "Sine", "Triangle", "Saw", "Square"}, 0));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("Osc2Waveshape", 1), "Osc2", juce::StringArray{ "Sine", "Triangle", "Saw", "Square", "Sine (WT)", "Triangle (WT)", "Saw (WT)", "Square (WT)"}, 0));
         layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("Osc2Unison", 1), "Unison", juce::StringArray{ "None", "2", "3", "4", "5", "6", "7", "8"}, 0));
         layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("Osc2Detune", 1), "Detune(%)", 0.0, 100, 30));
         layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("level2", 1), "Level", 0.0, 1, 0.5));
@@ -88,13 +172,19 @@ private:
         layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("sustain2", 1), "Sustain", 0.0, 1, 0.4));
         layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("release2", 1), "Release", 0.0, 5, 0.5));
 
+        // Audio-rate modulation between the main oscillators
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("OscCrossMod", 1), "Osc Cross Mod", CrossModulation::getChoices(), 0));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("OscCrossModDepth", 1), "Cross Mod Depth(%)", 0.0, 100, 50));
+
 
         // Reverb
         layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("Reverb", 1), "Reverb", false));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("ReverbType", 1), "Reverb Type", juce::StringArray{ "Algorithmic", "Convolution" }, 0));
+        layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("PipelinedReverb", 1), "Reverb on Worker", false));
 
         // Filter
         layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("FilterOn", 1), "Filter On", false));
-        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("filterType", 1), "Filter",juce::StringArray({ "LowPass","HighPass","BandPass" }), 0));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("filterType", 1), "Filter",juce::StringArray({ "LowPass","HighPass","BandPass","SVF LowPass","SVF HighPass","SVF BandPass","SVF Notch" }), 0));
         layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("cutOff", 1), "Cutoff Freq", 100, 1000, 120));
         layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("Q", 1), "Resonance", 0.0, 1, 0.2));
 
@@ -103,11 +193,21 @@ private:
         layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("LFO1Destination", 1), "LFO1Target", juce::StringArray{ "Osc1:AM", "Osc2:AM", "Osc1:FM", "Osc2:FM", "Osc1:PM", "Osc2:PM","FilterCutoffFreq" }, 0));
         layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("LFO1FreqParam", 1), "LFO1Freq", 0.00, 2.00, 1.00));
         layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("LFO1AmountParam", 1), "LFO1Amount(%)", 0.0, 100, 0.00));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("LFO1Mode", 1), "LFO1Mode", juce::StringArray{ "Retrigger", "Global" }, 0));
 
         layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("LFO2Waveshape", 1), "LFO2", juce::StringArray{ "Sine", "Triangle", "Saw", "Square" }, 0));
         layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("LFO2Destination", 1), "LFO2Target", juce::StringArray{ "Osc1:AM", "Osc2:AM", "Osc1:FM", "Osc2:FM", "Osc1:PM", "Osc2:PM","FilterCutoffFreq" }, 0));
         layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("LFO2FreqParam", 1), "LFO2Freq", 0.00, 2.00, 1.00));
         layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("LFO2AmountParam", 1), "LFO2Amount(%)", 0.0, 100, 0.00));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("LFO2Mode", 1), "LFO2Mode", juce::StringArray{ "Retrigger", "Global" }, 0));
+
+        // Voices
+        layout.add(std::make_unique<juce::AudioParameterInt>(juce::ParameterID("Polyphony", 1), "Polyphony", 1, synthEngine::maxVoices, 4));
+        layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("ParallelVoices", 1), "Multi-core Voices", false));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("MinSubBlock", 1), "Min Sub-block", MidiScheduler::getMinimumSubBlockChoices(), 2));
+
+        // Modulation update interval, "Per Sample" is the reference path
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("ModulationRate", 1), "Mod Rate", ControlRate::getChoices(), 2));
 
 
         return layout;
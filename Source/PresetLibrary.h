@@ -0,0 +1,567 @@
+/*
+  ==============================================================================
+
+    PresetLibrary.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef PRESET_LIBRARY_H
+#define PRESET_LIBRARY_H
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+#include <JuceHeader.h>
+#include "PresetState.h"
+
+/// A preset to write into a bank
+struct BankPreset
+{
+    juce::String name;
+    juce::StringArray tags;
+    juce::uint64 fingerprint = 0;                    // PresetSwap::getFingerprint() of the preset
+    juce::MemoryBlock state;                         // binary chunk of PresetSwap::writeBinary()
+};
+
+/// A bank of presets in one file, memory-mapped and read in place. The file holds an index and the presets:
+///   header      magic, version, number of presets, number of tags, offsets (8 ints)
+///   entries     per preset, sorted by name: fingerprint, tag bits, name and state offsets and sizes (32 bytes)
+///   tag names   null-terminated, bit n of the entries' tag bits is tag n
+///   names       UTF-8
+///   states      binary chunks of PresetSwap::writeBinary()
+/// A search by name is a binary search of the entries, a search by tag or by fingerprint a scan of them,
+/// none of them reads the states. Loading a preset reads the pages of its state only.
+class PresetBank
+{
+public:
+    static constexpr int magic = 0x42795350;         // "PSyB" in little-endian
+    static constexpr int version = 1;
+    static constexpr int maxTags = 64;
+    static constexpr int headerSize = 32;
+    static constexpr int entrySize = 32;
+
+    /// write a bank, replacing the file once it is complete
+    /// On Windows a file that is mapped can't be replaced: writing over the bank a PresetLibrary has open
+    /// (or still holds for a load in flight) fails and leaves the old file as it was; open another bank first.
+    /// @param juce::File, destination
+    /// @param std::vector<BankPreset>, presets in any order, tags after the first 64 distinct ones are dropped
+    /// @return bool, false if the file can't be written or replaced
+    static bool write(const juce::File& _file, std::vector<BankPreset> _presets)
+    {
+        std::stable_sort(_presets.begin(), _presets.end(), [](const BankPreset& _a, const BankPreset& _b)
+        {
+            return _a.name.compareIgnoreCase(_b.name) < 0;
+        });
+
+        juce::StringArray tagNames;
+        for (const auto& preset : _presets)
+            for (const auto& tag : preset.tags)
+                if (!tagNames.contains(tag) && tagNames.size() < maxTags)
+                    tagNames.add(tag);
+
+        const auto tagNamesOffset = (juce::uint32) (headerSize + entrySize * _presets.size());
+        juce::uint32 tagNamesSize = 0;
+        for (const auto& tag : tagNames)
+            tagNamesSize += (juce::uint32) tag.getNumBytesAsUTF8() + 1;
+
+        juce::TemporaryFile temporary(_file);
+        {
+            juce::FileOutputStream stream(temporary.getFile());
+            if (!stream.openedOk())
+                return false;
+
+            stream.writeInt(magic);
+            stream.writeInt(version);
+            stream.writeInt((int) _presets.size());
+            stream.writeInt(tagNames.size());
+            stream.writeInt(headerSize);
+            stream.writeInt((int) tagNamesOffset);
+            stream.writeInt((int) tagNamesSize);
+            stream.writeInt(0);
+
+            // the names follow the tag names, the states follow the names
+            juce::uint32 nameOffset = tagNamesOffset + tagNamesSize;
+            juce::uint32 stateOffset = nameOffset;
+            for (const auto& preset : _presets)
+                stateOffset += (juce::uint32) preset.name.getNumBytesAsUTF8();
+
+            for (const auto& preset : _presets)
+            {
+                juce::uint64 tags = 0;
+                for (const auto& tag : preset.tags)
+                    if (tagNames.contains(tag))
+                        tags |= (juce::uint64) 1 << tagNames.indexOf(tag);
+
+                const auto nameSize = (juce::uint32) preset.name.getNumBytesAsUTF8();
+                stream.writeInt64((juce::int64) preset.fingerprint);
+                stream.writeInt64((juce::int64) tags);
+                stream.writeInt((int) nameOffset);
+                stream.writeInt((int) nameSize);
+                stream.writeInt((int) stateOffset);
+                stream.writeInt((int) preset.state.getSize());
+
+                nameOffset += nameSize;
+                stateOffset += (juce::uint32) preset.state.getSize();
+            }
+
+            for (const auto& tag : tagNames)
+                stream.writeString(tag);
+
+            for (const auto& preset : _presets)
+                stream.write(preset.name.toRawUTF8(), preset.name.getNumBytesAsUTF8());
+
+            for (const auto& preset : _presets)
+                stream.write(preset.state.getData(), preset.state.getSize());
+
+            stream.flush();
+        }
+
+        return temporary.overwriteTargetFileWithTemporary();
+    }
+
+    /// map a bank file and check its index, on the calling thread
+    /// @return std::unique_ptr<PresetBank>, nullptr if the file is not a bank or is damaged
+    static std::unique_ptr<PresetBank> open(const juce::File& _file)
+    {
+        std::unique_ptr<PresetBank> bank(new PresetBank(_file));
+        return bank->isValid() ? std::move(bank) : nullptr;
+    }
+
+    const juce::File& getFile() const { return file; }
+    int getNumPresets() const { return numPresets; }
+    const juce::StringArray& getTagNames() const { return tagNames; }
+
+    juce::String getName(int _index) const
+    {
+        return juce::String::fromUTF8(getBytes(entryInt(_index, 16)), (int) entryInt(_index, 20));
+    }
+
+    /// bit n set for the preset's tag n of getTagNames()
+    juce::uint64 getTags(int _index) const { return juce::ByteOrder::littleEndianInt64(getEntry(_index) + 8); }
+
+    juce::uint64 getFingerprint(int _index) const { return juce::ByteOrder::littleEndianInt64(getEntry(_index)); }
+
+    /// the binary state chunk of a preset, in the mapped file
+    /// @param int, preset index
+    /// @param int&, size in bytes
+    const void* getState(int _index, int& _size) const
+    {
+        _size = (int) entryInt(_index, 28);
+        return getBytes(entryInt(_index, 24));
+    }
+
+    /// presets whose name starts with a prefix, ignoring case
+    /// @return juce::Range<int>, preset indices, empty if none
+    juce::Range<int> findByName(const juce::String& _prefix) const
+    {
+        // the names are sorted, the matches are one run: the run starts at the first name not before the prefix
+        int start = 0;
+        for (int count = numPresets; count > 0;)
+        {
+            const int half = count / 2;
+            if (getName(start + half).compareIgnoreCase(_prefix) < 0)
+            {
+                start += half + 1;
+                count -= half + 1;
+            }
+            else
+            {
+                count = half;
+            }
+        }
+
+        int end = start;
+        for (int count = numPresets - start; count > 0;)
+        {
+            const int half = count / 2;
+            if (getName(end + half).startsWithIgnoreCase(_prefix))
+            {
+                end += half + 1;
+                count -= half + 1;
+            }
+            else
+            {
+                count = half;
+            }
+        }
+
+        return { start, end };
+    }
+
+    /// presets carrying every tag of a set
+    /// @param juce::uint64, tag bits
+    std::vector<int> findByTags(juce::uint64 _tags) const
+    {
+        std::vector<int> found;
+        for (int i = 0; i < numPresets; i++)
+            if ((getTags(i) & _tags) == _tags)
+                found.push_back(i);
+
+        return found;
+    }
+
+    /// the presets with the closest fingerprints, closest first
+    /// @param juce::uint64, fingerprint to match
+    /// @param int, maximum number of presets
+    std::vector<int> findSimilar(juce::uint64 _fingerprint, int _maxResults) const
+    {
+        std::vector<std::pair<int, int>> distances((size_t) numPresets);
+        for (int i = 0; i < numPresets; i++)
+            distances[(size_t) i] = { getFingerprintDistance(getFingerprint(i), _fingerprint), i };
+
+        const auto count = (size_t) juce::jlimit(0, numPresets, _maxResults);
+        std::partial_sort(distances.begin(), distances.begin() + (std::ptrdiff_t) count, distances.end());
+
+        std::vector<int> found(count);
+        for (size_t i = 0; i < count; i++)
+            found[i] = distances[i].second;
+
+        return found;
+    }
+
+    /// sum of the differences of the 16 fingerprint values, 0 - 240
+    static int getFingerprintDistance(juce::uint64 _a, juce::uint64 _b)
+    {
+        int distance = 0;
+        for (int f = 0; f < 16; f++)
+            distance += std::abs((int) ((_a >> (4 * f)) & 15) - (int) ((_b >> (4 * f)) & 15));
+
+        return distance;
+    }
+
+    /// read every page of a preset's state, a later getState() then doesn't wait for the disk
+    void touchState(int _index) const
+    {
+        touch(entryInt(_index, 24), entryInt(_index, 28));
+    }
+
+private:
+    explicit PresetBank(const juce::File& _file)
+        : file(_file), map(_file, juce::MemoryMappedFile::readOnly)
+    {
+    }
+
+    /// check the index against the size of the file, which also reads its pages
+    bool isValid()
+    {
+        const auto size = (juce::uint64) map.getSize();
+        if (map.getData() == nullptr || size < (juce::uint64) headerSize
+            || headerInt(0) != (juce::uint32) magic || headerInt(1) > (juce::uint32) version)
+            return false;
+
+        numPresets = (int) headerInt(2);
+        const auto numTags = headerInt(3);
+        entries = headerInt(4);
+        const auto tagNamesOffset = headerInt(5);
+        const auto tagNamesSize = headerInt(6);
+
+        if (numPresets < 0 || numTags > (juce::uint32) maxTags
+            || (juce::uint64) entries + (juce::uint64) numPresets * entrySize > size
+            || (juce::uint64) tagNamesOffset + tagNamesSize > size)
+            return false;
+
+        for (int i = 0; i < numPresets; i++)
+            if ((juce::uint64) entryInt(i, 16) + entryInt(i, 20) > size || (juce::uint64) entryInt(i, 24) + entryInt(i, 28) > size)
+                return false;
+
+        for (juce::uint32 offset = tagNamesOffset, end = tagNamesOffset + tagNamesSize; offset < end && tagNames.size() < (int) numTags;)
+        {
+            const auto* name = getBytes(offset);
+            const auto length = (juce::uint32) strnlen(name, end - offset);
+            tagNames.add(juce::String::fromUTF8(name, (int) length));
+            offset += length + 1;
+        }
+
+        // the names are read by every search
+        for (int i = 0; i < numPresets; i++)
+            touch(entryInt(i, 16), entryInt(i, 20));
+
+        return true;
+    }
+
+    void touch(juce::uint32 _offset, juce::uint32 _size) const
+    {
+        static constexpr juce::uint32 pageSize = 4096;
+        const volatile char* bytes = getBytes(_offset);
+
+        for (juce::uint32 i = 0; i < _size; i += pageSize)
+            (void) bytes[i];
+    }
+
+    const char* getBytes(juce::uint32 _offset) const { return static_cast<const char*>(map.getData()) + _offset; }
+    juce::uint32 headerInt(int _field) const { return juce::ByteOrder::littleEndianInt(getBytes((juce::uint32) (4 * _field))); }
+    const char* getEntry(int _index) const { return getBytes(entries + (juce::uint32) _index * entrySize); }
+    juce::uint32 entryInt(int _index, int _byte) const { return juce::ByteOrder::littleEndianInt(getEntry(_index) + _byte); }
+
+    juce::File file;
+    juce::MemoryMappedFile map;
+    int numPresets = 0;
+    juce::uint32 entries = 0;                        // offset of the entries
+    juce::StringArray tagNames;
+
+    JUCE_DECLARE_NON_COPYABLE(PresetBank)
+};
+
+/// Opens preset banks and loads their presets on a background thread, the message thread and the audio
+/// thread never wait for the disk or for parsing. A loaded preset is handed to the message thread, which
+/// passes it to PresetSwap::load(). After each load the neighbours of the preset in the bank (the next
+/// ones a browser steps to) are read and parsed ahead, so stepping through a bank is served from memory.
+/// The thread is started by the first request, a library that never opens a bank holds no thread.
+class PresetLibrary : private juce::Thread,
+                      private juce::AsyncUpdater
+{
+public:
+    static constexpr int prefetchAhead = 3;          // presets after the loaded one, parsed in advance
+    static constexpr int prefetchBehind = 1;
+
+    /// @param PresetSwap&, parameters of the processor, used to parse the presets
+    explicit PresetLibrary(const PresetSwap& _presets) : juce::Thread("Preset Library"), presets(_presets) {}
+
+    ~PresetLibrary() override
+    {
+        cancelPendingUpdate();
+        stopThread(2000);
+    }
+
+    /// the parameters that make the fingerprint of a preset
+    static juce::StringArray getFingerprintParameters()
+    {
+        return { "Osc1Waveshape", "Osc2Waveshape", "Osc1Unison", "Osc2Unison", "level1", "level2",
+                 "attack1", "release1", "attack2", "release2", "FilterOn", "filterType", "cutOff", "Q",
+                 "LFO1Destination", "LFO1AmountParam" };
+    }
+
+    /// called on the message thread once a bank opened by openBank() is ready to browse
+    std::function<void()> onBankOpened;
+
+    /// called on the message thread with a preset requested by loadPreset()
+    std::function<void(int, std::unique_ptr<PresetState>)> onPresetLoaded;
+
+    /// open a bank in the background (message thread)
+    void openBank(const juce::File& _file)
+    {
+        {
+            const juce::ScopedLock lock(exchangeLock);
+            bankRequest = _file;
+            bankRequested = true;
+            anyBankRequested = true;
+        }
+
+        startWorker();
+        notify();
+    }
+
+    /// load a preset of the open bank in the background (any thread, hosts change programs from theirs)
+    /// While a bank passed to openBank() is still being opened, the preset is loaded from that bank.
+    /// @param int, preset index
+    void loadPreset(int _index)
+    {
+        {
+            const juce::ScopedLock lock(exchangeLock);
+            if (_index < 0 || !anyBankRequested)
+                return;
+
+            presetRequest = _index;
+        }
+
+        startWorker();
+        notify();
+    }
+
+    /// the open bank, for browsing and searching (any thread), nullptr if none is open
+    /// The caller's reference keeps the bank mapped after the library has moved on to another one.
+    std::shared_ptr<const PresetBank> getBank() const
+    {
+        const juce::SpinLock::ScopedLockType lock(bankLock);
+        return bank;
+    }
+
+    juce::File getBankFile() const
+    {
+        const auto current = getBank();
+        return current != nullptr ? current->getFile() : juce::File();
+    }
+
+    /// the current parameter values as a preset to write into a bank (message thread)
+    /// @param juce::String, preset name
+    /// @param juce::StringArray, tags
+    BankPreset createBankPreset(const juce::String& _name, const juce::StringArray& _tags) const
+    {
+        BankPreset preset;
+        preset.name = _name;
+        preset.tags = _tags;
+        preset.fingerprint = presets.getFingerprint(*presets.capture(), getFingerprintParameters());
+        presets.writeBinary(preset.state, {}, {});
+        return preset;
+    }
+
+    /// parse a preset of a bank on the calling thread
+    /// @return std::unique_ptr<PresetState>, nullptr if the preset's state is damaged
+    std::unique_ptr<PresetState> parse(const PresetBank& _bank, int _index) const
+    {
+        int size = 0;
+        const void* state = _bank.getState(_index, size);
+        return presets.readBinary(state, size);
+    }
+
+private:
+    /// start the thread on the first request, a second caller finds it running (any thread)
+    void startWorker()
+    {
+        if (!isThreadRunning())
+            startThread(juce::Thread::Priority::background);
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            juce::File bankFile;
+            bool openBankNow = false;
+            int index = -1;
+
+            {
+                const juce::ScopedLock lock(exchangeLock);
+                std::swap(openBankNow, bankRequested);
+                bankFile = bankRequest;
+                std::swap(index, presetRequest);
+            }
+
+            if (openBankNow)
+            {
+                std::shared_ptr<const PresetBank> opened(PresetBank::open(bankFile));
+                if (opened != nullptr)
+                    latestBank = opened;
+
+                {
+                    const juce::ScopedLock lock(exchangeLock);
+                    openedBank = std::move(opened);
+                    bankOpened = true;
+                }
+
+                triggerAsyncUpdate();
+            }
+
+            // a preset requested together with a bank is loaded after it, from the new bank
+            if (index >= 0 && latestBank != nullptr && juce::isPositiveAndBelow(index, latestBank->getNumPresets()))
+                loadAndPrefetch(latestBank, index);
+            else if (!openBankNow)
+                wait(-1);
+        }
+    }
+
+    /// parse a preset, or take it from the prefetched ones, hand it over, then parse its neighbours
+    void loadAndPrefetch(std::shared_ptr<const PresetBank> _bank, int _index)
+    {
+        if (_bank != prefetchedBank)
+        {
+            prefetched.clear();
+            prefetchedBank = _bank;
+        }
+
+        auto found = prefetched.find(_index);
+        auto preset = found != prefetched.end() ? std::move(found->second) : parse(*_bank, _index);
+        prefetched.erase(_index);
+
+        {
+            const juce::ScopedLock lock(exchangeLock);
+            loadedPreset = std::move(preset);
+            loadedIndex = _index;
+            loadedBank = _bank;
+        }
+
+        triggerAsyncUpdate();
+
+        // only the neighbours are kept
+        for (auto it = prefetched.begin(); it != prefetched.end();)
+            it = it->first - _index > prefetchAhead || _index - it->first > prefetchBehind ? prefetched.erase(it) : std::next(it);
+
+        // the presets after the loaded one first, then the ones before
+        for (int step = 1; step <= prefetchAhead + prefetchBehind; step++)
+        {
+            const int neighbour = step <= prefetchAhead ? _index + step : _index + prefetchAhead - step;
+            if (!juce::isPositiveAndBelow(neighbour, _bank->getNumPresets()) || prefetched.count(neighbour) > 0)
+                continue;
+
+            // a new request goes first
+            if (hasRequest())
+                return;
+
+            _bank->touchState(neighbour);
+            prefetched[neighbour] = parse(*_bank, neighbour);
+        }
+    }
+
+
+    bool hasRequest() const
+    {
+        const juce::ScopedLock lock(exchangeLock);
+        return bankRequested || presetRequest >= 0;
+    }
+
+    /// hand the results of the worker to the callbacks
+    void handleAsyncUpdate() override
+    {
+        std::shared_ptr<const PresetBank> opened;
+        bool newBank = false;
+        std::unique_ptr<PresetState> preset;
+        int index = -1;
+        std::shared_ptr<const PresetBank> presetBank;
+
+        {
+            const juce::ScopedLock lock(exchangeLock);
+            std::swap(newBank, bankOpened);
+            opened = std::move(openedBank);
+            preset = std::move(loadedPreset);
+            index = loadedIndex;
+            presetBank = std::move(loadedBank);
+        }
+
+        if (newBank && opened != nullptr)
+        {
+            {
+                const juce::SpinLock::ScopedLockType lock(bankLock);
+                std::swap(bank, opened);
+            }
+
+            // opened now holds the previous bank, unmapped when it goes out of scope unless a reader still holds it
+            if (onBankOpened != nullptr)
+                onBankOpened();
+        }
+
+        // a preset of a bank replaced in the meantime is dropped
+        if (preset != nullptr && presetBank == bank && onPresetLoaded != nullptr)
+            onPresetLoaded(index, std::move(preset));
+    }
+
+    const PresetSwap& presets;
+    std::shared_ptr<const PresetBank> bank;          // written on the message thread, read through getBank()
+    mutable juce::SpinLock bankLock;                 // only held to copy or swap the pointer
+
+    // requests and results, the lock is only held to move them
+    juce::CriticalSection exchangeLock;
+    juce::File bankRequest;
+    bool bankRequested = false;
+    bool anyBankRequested = false;                   // openBank() was called, loadPreset() may run ahead of the bank
+    int presetRequest = -1;
+    std::shared_ptr<const PresetBank> openedBank;
+    bool bankOpened = false;
+    std::unique_ptr<PresetState> loadedPreset;
+    int loadedIndex = -1;
+    std::shared_ptr<const PresetBank> loadedBank;
+
+    // worker only
+    std::shared_ptr<const PresetBank> latestBank;    // the last bank opened, the open bank once the message thread has it
+    std::shared_ptr<const PresetBank> prefetchedBank;
+    std::map<int, std::unique_ptr<PresetState>> prefetched;
+
+    JUCE_DECLARE_NON_COPYABLE(PresetLibrary)
+};
+
+#endif // PRESET_LIBRARY_H
@@ -0,0 +1,330 @@
+/*
+  ==============================================================================
+
+    PresetState.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef PRESET_STATE_H
+#define PRESET_STATE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <JuceHeader.h>
+
+/// A complete set of parameter values, read from a saved state and handed to the audio thread in one piece.
+struct PresetState
+{
+    std::vector<float> values;                       // unnormalised, in the order of the processor's parameters
+    juce::String impulseResponse;                    // file of the "Convolution" reverb type, empty if none
+    juce::String presetBank;                         // preset bank file open when the state was saved, empty if none
+    std::atomic<bool> applied { false };             // set once the parameters themselves hold the values
+    PresetState* next = nullptr;                     // list of states retired by the audio thread
+};
+
+/// The parameter values the audio thread works with for a block, and the state format of the plugin.
+///
+/// The values of every parameter are copied at the start of each block into one array, which the voices
+/// and the processor read instead of the parameters. A preset (a restored state) is published to the audio
+/// thread as one PresetState through an atomic pointer and replaces the whole array at the next block,
+/// while the message thread sets the parameters one by one for the host and the editor. The audio thread
+/// keeps the preset's values until they are all set, so no block runs with half of a preset.
+///
+/// The state is saved as a binary chunk:
+///   int     magic ("PSyn")
+///   int     version
+///   int     layout hash, of the parameter IDs in order
+///   string  impulse response file
+///   string  preset bank file (version 2)
+///   int     number of values
+///   float   values, unnormalised, in parameter order
+///   string  parameter IDs, in the same order
+/// When the layout hash matches the plugin's the values are read in order and the IDs are skipped,
+/// otherwise they are matched by ID and missing parameters get their default. States saved as XML
+/// by earlier versions are still read.
+class PresetSwap
+{
+public:
+    static constexpr int binaryMagic = 0x6e795350;   // "PSyn" in little-endian
+    static constexpr int binaryVersion = 2;
+
+    ~PresetSwap()
+    {
+        delete pending.exchange(nullptr);
+        delete held;
+        deleteRetired();
+    }
+
+    /// list the parameters and take their current values, call it once from the processor constructor
+    /// @param juce::AudioProcessor&, processor owning the parameters
+    /// @param juce::AudioProcessorValueTreeState&, parameter tree
+    void attach(juce::AudioProcessor& _processor, juce::AudioProcessorValueTreeState& _apvts)
+    {
+        for (auto* parameter : _processor.getParameters())
+        {
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+            {
+                parameters.push_back(ranged);
+                ids.push_back(ranged->getParameterID());
+                rawValues.push_back(_apvts.getRawParameterValue(ranged->getParameterID()));
+            }
+        }
+
+        // FNV-1a over the IDs and their terminators
+        layoutHash = 2166136261u;
+        for (const auto& id : ids)
+            for (const char* c = id.toRawUTF8();; c++)
+            {
+                layoutHash = (layoutHash ^ (juce::uint8) *c) * 16777619u;
+                if (*c == 0)
+                    break;
+            }
+
+        blockValues = std::make_unique<std::atomic<float>[]>(rawValues.size());
+        for (size_t i = 0; i < rawValues.size(); i++)
+            blockValues[i].store(rawValues[i]->load());
+    }
+
+    /// the value of a parameter for the current block, the array element keeps its address
+    /// @param juce::String, parameter ID
+    std::atomic<float>* getRawParameterValue(const juce::String& _id) const
+    {
+        for (size_t i = 0; i < ids.size(); i++)
+            if (ids[i] == _id)
+                return &blockValues[i];
+
+        jassertfalse;
+        return nullptr;
+    }
+
+    /// take the values of the block (audio thread, start of processBlock)
+    void beginBlock()
+    {
+        if (auto* preset = pending.exchange(nullptr, std::memory_order_acquire))
+        {
+            retire(held);
+            held = preset;
+        }
+
+        // once the parameters hold the preset they are read again, host automation included
+        if (held != nullptr && held->applied.load(std::memory_order_acquire))
+        {
+            retire(held);
+            held = nullptr;
+        }
+
+        if (held != nullptr)
+        {
+            for (size_t i = 0; i < rawValues.size(); i++)
+                blockValues[i].store(held->values[i], std::memory_order_relaxed);
+        }
+        else
+        {
+            for (size_t i = 0; i < rawValues.size(); i++)
+                blockValues[i].store(rawValues[i]->load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+
+    /// check for the binary chunk, anything else is handed to the XML reader
+    static bool isBinary(const void* _data, int _sizeInBytes)
+    {
+        if (_data == nullptr || _sizeInBytes < 8)
+            return false;
+
+        juce::MemoryInputStream stream(_data, (size_t) _sizeInBytes, false);
+        return stream.readInt() == binaryMagic;
+    }
+
+    /// write the current parameter values as the binary chunk (message thread)
+    /// @param juce::MemoryBlock&, destination, replaced
+    /// @param juce::String, impulse response file
+    /// @param juce::String, preset bank file
+    void writeBinary(juce::MemoryBlock& _dest, const juce::String& _impulseResponse, const juce::String& _presetBank) const
+    {
+        juce::MemoryOutputStream stream(_dest, false);
+
+        stream.writeInt(binaryMagic);
+        stream.writeInt(binaryVersion);
+        stream.writeInt((int) layoutHash);
+        stream.writeString(_impulseResponse);
+        stream.writeString(_presetBank);
+        stream.writeInt((int) rawValues.size());
+
+        for (auto* value : rawValues)
+            stream.writeFloat(value->load());
+
+        for (const auto& id : ids)
+            stream.writeString(id);
+
+        stream.flush();
+    }
+
+    /// read a binary chunk
+    /// @return std::unique_ptr<PresetState>, nullptr if the chunk is damaged or from a later version
+    std::unique_ptr<PresetState> readBinary(const void* _data, int _sizeInBytes) const
+    {
+        juce::MemoryInputStream stream(_data, (size_t) _sizeInBytes, false);
+
+        if (stream.readInt() != binaryMagic)
+            return nullptr;
+
+        const int version = stream.readInt();
+        if (version > binaryVersion)
+            return nullptr;
+
+        const auto hash = (juce::uint32) stream.readInt();
+        auto preset = createDefault();
+        preset->impulseResponse = stream.readString();
+        if (version >= 2)
+            preset->presetBank = stream.readString();
+
+        const int numValues = stream.readInt();
+        if (numValues < 0 || stream.getNumBytesRemaining() < (juce::int64) numValues * 4)
+            return nullptr;
+
+        if (hash == layoutHash && numValues == (int) parameters.size())
+        {
+            for (size_t i = 0; i < parameters.size(); i++)
+                preset->values[i] = legalise(i, stream.readFloat());
+
+            return preset;
+        }
+
+        // the parameters changed since the state was saved, match the values to the IDs after them
+        std::vector<float> values((size_t) numValues);
+        for (auto& value : values)
+            value = stream.readFloat();
+
+        for (int v = 0; v < numValues && !stream.isExhausted(); v++)
+        {
+            const auto id = stream.readString();
+            for (size_t i = 0; i < ids.size(); i++)
+                if (ids[i] == id)
+                    preset->values[i] = legalise(i, values[(size_t) v]);
+        }
+
+        return preset;
+    }
+
+    /// read the XML of juce::AudioProcessorValueTreeState::copyState(), the state format of earlier versions
+    /// @param juce::XmlElement, the tree's root element
+    std::unique_ptr<PresetState> readXml(const juce::XmlElement& _xml) const
+    {
+        auto preset = createDefault();
+        preset->impulseResponse = _xml.getStringAttribute("ImpulseResponse");
+        preset->presetBank = _xml.getStringAttribute("PresetBank");
+
+        for (size_t i = 0; i < ids.size(); i++)
+            if (auto* element = _xml.getChildByAttribute("id", ids[i]))
+                preset->values[i] = legalise(i, (float) element->getDoubleAttribute("value", preset->values[i]));
+
+        return preset;
+    }
+
+    /// the current values of the parameters as a preset (message thread)
+    std::unique_ptr<PresetState> capture() const
+    {
+        auto preset = std::make_unique<PresetState>();
+        preset->values.resize(rawValues.size());
+
+        for (size_t i = 0; i < rawValues.size(); i++)
+            preset->values[i] = rawValues[i]->load();
+
+        return preset;
+    }
+
+    /// coarse fingerprint of a preset, 4 bits of the normalised value of each of up to 16 parameters,
+    /// close fingerprints are presets with similar settings of these parameters
+    /// @param PresetState, preset
+    /// @param juce::StringArray, parameter IDs, the first takes the lowest 4 bits
+    juce::uint64 getFingerprint(const PresetState& _preset, const juce::StringArray& _ids) const
+    {
+        juce::uint64 fingerprint = 0;
+
+        for (int f = 0; f < juce::jmin(16, (int) _ids.size()); f++)
+            for (size_t i = 0; i < ids.size(); i++)
+                if (ids[i] == _ids[f])
+                {
+                    const float normalised = parameters[i]->convertTo0to1(_preset.values[i]);
+                    fingerprint |= (juce::uint64) juce::roundToInt(juce::jlimit(0.0f, 1.0f, normalised) * 15.0f) << (4 * f);
+                }
+
+        return fingerprint;
+    }
+
+    /// hand a preset to the audio thread, then set the parameters to its values (message thread)
+    void load(std::unique_ptr<PresetState> _preset)
+    {
+        deleteRetired();
+
+        auto* preset = _preset.release();
+        delete pending.exchange(preset, std::memory_order_acq_rel);    // a preset the audio thread never took
+
+        // only the parameters that change are set, a recalled project mostly holds default values
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            const float normalised = parameters[i]->convertTo0to1(preset->values[i]);
+            if (parameters[i]->getValue() != normalised)
+                parameters[i]->setValueNotifyingHost(normalised);
+        }
+
+        preset->applied.store(true, std::memory_order_release);
+    }
+
+private:
+    /// a preset holding the default of every parameter
+    std::unique_ptr<PresetState> createDefault() const
+    {
+        auto preset = std::make_unique<PresetState>();
+        preset->values.resize(parameters.size());
+
+        for (size_t i = 0; i < parameters.size(); i++)
+            preset->values[i] = parameters[i]->convertFrom0to1(parameters[i]->getDefaultValue());
+
+        return preset;
+    }
+
+    /// the value the parameter takes when set to _value, the audio thread sees no step when the preset is released
+    float legalise(size_t _index, float _value) const
+    {
+        return parameters[_index]->convertFrom0to1(parameters[_index]->convertTo0to1(_value));
+    }
+
+    /// hand a preset back to the message thread, which deletes it at the next load (audio thread, lock-free)
+    void retire(PresetState* _preset)
+    {
+        if (_preset == nullptr)
+            return;
+
+        _preset->next = retired.load(std::memory_order_relaxed);
+        while (!retired.compare_exchange_weak(_preset->next, _preset, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void deleteRetired()
+    {
+        for (auto* preset = retired.exchange(nullptr, std::memory_order_acquire); preset != nullptr;)
+        {
+            auto* next = preset->next;
+            delete preset;
+            preset = next;
+        }
+    }
+
+    std::vector<juce::RangedAudioParameter*> parameters;
+    std::vector<juce::String> ids;
+    std::vector<std::atomic<float>*> rawValues;      // the parameter tree's values
+    std::unique_ptr<std::atomic<float>[]> blockValues;
+    juce::uint32 layoutHash = 0;
+
+    std::atomic<PresetState*> pending { nullptr };   // published by load(), taken by beginBlock()
+    PresetState* held = nullptr;                     // preset the audio thread reads instead of the parameters
+    std::atomic<PresetState*> retired { nullptr };
+};
+
+#endif // PRESET_STATE_H
@@ -0,0 +1,232 @@
+/*
+  ==============================================================================
+
+    ReverbPipeline.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef REVERB_PIPELINE_H
+#define REVERB_PIPELINE_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <JuceHeader.h>
+#include "SpinWait.h"
+
+/// Runs the effects stage one block behind the voices, on a realtime worker thread.
+/// Every block is copied into a stereo ring buffer and handed to the worker, which processes it in place
+/// while the audio thread renders the next block. The audio thread then waits for that job and plays
+/// samples from the ring exactly getLatencySamples() (the maximum block size) behind the input. Every
+/// output sample therefore comes from a block whose job has finished, whatever the host's block sizes.
+/// The handoff is one job in flight, published through an atomic flag; the worker sleeps on an atomic wait/notify.
+/// The worker is only started by start(), once the mode is switched on; until then the stage runs inline,
+/// still one block behind.
+class ReverbPipeline
+{
+public:
+    /// the effects stage, processes a stereo block in place
+    /// @param float*, left channel
+    /// @param float*, right channel
+    /// @param int, number of samples
+    /// @param bool, true if the input block is digital silence
+    using Stage = std::function<void(float*, float*, int, bool)>;
+
+    ~ReverbPipeline()
+    {
+        release();
+    }
+
+    /// allocate the ring buffer and stop the worker (prepareToPlay)
+    /// @param int, maximum block size, also the latency
+    /// @param double, sample rate, used for the realtime thread scheduling hints
+    /// @param Stage, effects stage, called on the worker
+    void prepare(int _maxBlockSize, double _sampleRate, Stage _stage)
+    {
+        release();
+
+        stage = std::move(_stage);
+        latency = juce::jmax(1, _maxBlockSize);
+        sampleRate = _sampleRate;
+        for (auto& channel : ring)
+            channel.assign((size_t) (2 * latency), 0.0f);
+
+        reset();
+    }
+
+    /// start the worker if it is not running yet (message thread, or prepareToPlay), it runs until release()
+    void start()
+    {
+        if (started.load(std::memory_order_acquire))
+            return;
+
+        // on a single core the stage runs inline, still one block behind so the latency does not change
+        if (juce::SystemStats::getNumCpus() > 1)
+        {
+            worker = std::make_unique<Worker>(*this);
+            worker->startRealtimeThread(juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime(latency, sampleRate));
+        }
+
+        // the audio thread reads the worker only after this
+        started.store(true, std::memory_order_release);
+    }
+
+    /// true once start() has run
+    bool isStarted() const
+    {
+        return started.load(std::memory_order_acquire);
+    }
+
+    /// stop the worker (releaseResources)
+    void release()
+    {
+        started.store(false, std::memory_order_release);
+
+        if (worker != nullptr)
+        {
+            worker->signalThreadShouldExit();
+            wakeCounter.fetch_add(1, std::memory_order_release);
+            wakeCounter.notify_all();
+            worker->stopThread(1000);
+            worker.reset();
+        }
+
+        jobPending.store(false, std::memory_order_release);
+    }
+
+    /// drop the delayed samples, the next getLatencySamples() output samples are silent (audio thread)
+    void reset()
+    {
+        waitForJob();
+
+        for (auto& channel : ring)
+            std::fill(channel.begin(), channel.end(), 0.0f);
+
+        writePosition = 0;
+    }
+
+    /// samples between the input and the output of process()
+    int getLatencySamples() const { return latency; }
+
+    /// hand a block to the stage and replace it with the processed samples from getLatencySamples() earlier
+    /// @param float*, left channel
+    /// @param float*, right channel
+    /// @param int, number of samples
+    /// @param bool, true if the block is digital silence
+    void process(float* _left, float* _right, int _numSamples, bool _inputSilent)
+    {
+        // a host block longer than the prepared size is split, the ring only holds two
+        for (int done = 0; done < _numSamples;)
+        {
+            const int numSamples = juce::jmin(_numSamples - done, latency);
+            processChunk(_left + done, _right + done, numSamples, _inputSilent);
+            done += numSamples;
+        }
+    }
+
+private:
+    class Worker : public juce::Thread
+    {
+    public:
+        explicit Worker(ReverbPipeline& _owner) : juce::Thread("Reverb Pipeline"), owner(_owner) {}
+
+        void run() override
+        {
+            for (;;)
+            {
+                // read the counter before looking for a job, a job posted after the look changes the counter
+                const uint32_t seen = owner.wakeCounter.load(std::memory_order_acquire);
+
+                if (threadShouldExit())
+                    break;
+
+                if (owner.jobPending.load(std::memory_order_acquire))
+                {
+                    owner.runJob();
+                    owner.jobPending.store(false, std::memory_order_release);
+                }
+
+                owner.wakeCounter.wait(seen, std::memory_order_acquire);
+            }
+        }
+
+    private:
+        ReverbPipeline& owner;
+    };
+
+    void processChunk(float* _left, float* _right, int _numSamples, bool _inputSilent)
+    {
+        const int ringSize = 2 * latency;
+        const int readPosition = (writePosition + ringSize - latency) % ringSize;
+
+        // the previous job holds the last samples that are read now
+        waitForJob();
+
+        for (int i = 0, w = writePosition, r = readPosition; i < _numSamples; i++)
+        {
+            ring[0][(size_t) w] = _left[i];
+            ring[1][(size_t) w] = _right[i];
+            _left[i] = ring[0][(size_t) r];
+            _right[i] = ring[1][(size_t) r];
+
+            w = w + 1 == ringSize ? 0 : w + 1;
+            r = r + 1 == ringSize ? 0 : r + 1;
+        }
+
+        jobStart = writePosition;
+        jobLength = _numSamples;
+        jobSilent = _inputSilent;
+        writePosition = (writePosition + _numSamples) % ringSize;
+
+        if (!started.load(std::memory_order_acquire) || worker == nullptr)
+        {
+            runJob();
+            return;
+        }
+
+        jobPending.store(true, std::memory_order_release);
+        wakeCounter.fetch_add(1, std::memory_order_release);
+        wakeCounter.notify_one();
+    }
+
+    /// run the stage on the job's part of the ring, in two calls when it wraps around
+    void runJob()
+    {
+        const int ringSize = 2 * latency;
+        const int first = juce::jmin(jobLength, ringSize - jobStart);
+
+        stage(ring[0].data() + jobStart, ring[1].data() + jobStart, first, jobSilent);
+
+        if (first < jobLength)
+            stage(ring[0].data(), ring[1].data(), jobLength - first, jobSilent);
+    }
+
+    void waitForJob() const
+    {
+        SpinWait wait;
+        while (jobPending.load(std::memory_order_acquire))
+            wait.pause();
+    }
+
+    Stage stage;
+    std::vector<float> ring[2];
+    int latency = 1;
+    int writePosition = 0;
+
+    // job in flight, written by the audio thread before it is published through jobPending
+    int jobStart = 0;
+    int jobLength = 0;
+    bool jobSilent = false;
+
+    std::unique_ptr<Worker> worker;
+    std::atomic<bool> started { false };
+    double sampleRate = 44100.0;
+    std::atomic<bool> jobPending { false };
+    std::atomic<uint32_t> wakeCounter { 0 };
+};
+
+#endif // REVERB_PIPELINE_H
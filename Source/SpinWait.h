@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    SpinWait.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef SPIN_WAIT_H
+#define SPIN_WAIT_H
+
+#include <thread>
+#include <JuceHeader.h>
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#endif
+
+/// Busy wait of the audio thread on a worker it handed a job to. The job is due within the block, so
+/// the thread spins rather than sleeps, with the CPU's pause hint; a wait far longer than a job takes
+/// (the worker was descheduled) yields the core to it on every further spin.
+class SpinWait
+{
+public:
+    static constexpr int maxSpins = 4096;            // pause hints before yielding, up to a few hundred microseconds
+
+    /// call once per iteration of the waiting loop
+    void pause()
+    {
+        if (spins < maxSpins)
+        {
+            spins++;
+           #if JUCE_INTEL
+            _mm_pause();
+           #else
+            std::this_thread::yield();
+           #endif
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    int spins = 0;
+};
+
+#endif // SPIN_WAIT_H
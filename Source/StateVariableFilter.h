@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    StateVariableFilter.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef STATE_VARIABLE_FILTER_H
+#define STATE_VARIABLE_FILTER_H
+
+#include <JuceHeader.h>
+#include "FastMath.h"
+
+/// Coefficients of a topology-preserving (trapezoidal) state-variable filter, the two-pole filter
+/// of the "SVF" filter types. Its low pass, high pass and band pass outputs have the transfer functions
+/// of juce::IIRCoefficients::makeLowPass(), makeHighPass() and makeBandPass() with the same cutoff and Q,
+/// but the state is kept as the two integrator memories rather than as biquad delays, so the cutoff can
+/// change on every sample without clicks or instability. A change costs one FastMath::tan() and one
+/// division: the integrator gain g, and a1 = 1 / (1 + g (g + k)) with k = 1 / Q.
+///
+/// All four outputs come from the same two integrators; the one played is a mix of the input, the band
+/// and the low output, set per mode (the band pass is scaled by k to a peak gain of 1, as makeBandPass()):
+///   low pass   = low
+///   high pass  = input - k band - low
+///   band pass  = k band
+///   notch      = input - k band
+struct StateVariableCoefficients
+{
+    enum Mode
+    {
+        lowPass,
+        highPass,
+        bandPass,
+        notch,
+        numModes
+    };
+
+    static constexpr float minQ = 0.01f;             // k = 1 / Q, Q = 0 would divide by zero
+    static constexpr float maxCutoffRatio = 0.49f;   // of the sample rate, tan() has its pole at half of it
+    static constexpr FastMath::Accuracy tanAccuracy = FastMath::normal;   // 3e-6 of g at the highest cutoff
+
+    /// @param double, sample rate
+    /// @param float, cutoff frequency, limited to 1 Hz - maxCutoffRatio of the sample rate
+    /// @param float, resonance, limited to minQ and above
+    /// @param int, output mode (0 - low pass, 1 - high pass, 2 - band pass, 3 - notch)
+    static StateVariableCoefficients make(double _sampleRate, float _cutoff, float _Q, int _mode)
+    {
+        const float cutoff = juce::jlimit(1.0f, maxCutoffRatio * (float) _sampleRate, _cutoff);
+        const float g = FastMath::tan<tanAccuracy>(juce::MathConstants<float>::pi * cutoff / (float) _sampleRate);
+        const float k = 1.0f / juce::jmax(minQ, _Q);
+
+        static constexpr float inputGain[] = { 0.0f, 1.0f, 0.0f, 1.0f };
+        static constexpr float bandGain[] = { 0.0f, -1.0f, 1.0f, -1.0f };   // times k
+        static constexpr float lowGain[] = { 1.0f, -1.0f, 0.0f, 0.0f };
+        const int mode = juce::jlimit(0, numModes - 1, _mode);
+
+        StateVariableCoefficients result;
+        result.coefficients[0] = g;
+        result.coefficients[1] = 1.0f / (1.0f + g * (g + k));
+        result.coefficients[2] = inputGain[mode];
+        result.coefficients[3] = bandGain[mode] * k;
+        result.coefficients[4] = lowGain[mode];
+        return result;
+    }
+
+    float coefficients[5] = {};                      // g, a1, then the gains of the input, band and low outputs
+};
+
+/// One state-variable filter, a sample at a time. The voices run theirs in the lanes of their
+/// VoiceLaneGroup, this is the same recursion for a single channel.
+class StateVariableFilter
+{
+public:
+    void reset()
+    {
+        ic1 = ic2 = 0.0f;
+    }
+
+    /// @param float, input sample
+    /// @param StateVariableCoefficients, coefficients of the sample
+    /// @return float, output of the coefficients' mode
+    float processSample(float _in, const StateVariableCoefficients& _coefficients)
+    {
+        const float g = _coefficients.coefficients[0];
+        const float a1 = _coefficients.coefficients[1];
+        const float a2 = g * a1;
+        const float a3 = g * a2;
+
+        const float v3 = _in - ic2;
+        const float band = a1 * ic1 + a2 * v3;
+        const float low = ic2 + a2 * ic1 + a3 * v3;
+        ic1 = 2.0f * band - ic1;
+        ic2 = 2.0f * low - ic2;
+
+        return _coefficients.coefficients[2] * _in + _coefficients.coefficients[3] * band + _coefficients.coefficients[4] * low;
+    }
+
+private:
+    float ic1 = 0.0f, ic2 = 0.0f;                    // integrator memories
+};
+
+#endif // STATE_VARIABLE_FILTER_H
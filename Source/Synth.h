@@ -9,11 +9,20 @@
 */
 
 #pragma once
+#include <array>
 #include <JuceHeader.h>
+#include "FastMath.h"
 #include "Oscillators.h"
 #include "OscSwitch.h"
 #include "Filter.h"
 #include "LFO.h"
+#include "UnisonBank.h"
+#include "ControlRate.h"
+#include "ParallelVoiceRenderer.h"
+#include "VoiceScratchArena.h"
+#include "VoiceBank.h"
+#include "SynthParameters.h"
+#include "DspProfiler.h"
 
 class synthSound : public juce::SynthesiserSound
 {
@@ -31,53 +40,42 @@ public:
     /** The class is reference-counted, so this is a handy pointer class for it. */
 };
 
-class synthVoice : public juce::SynthesiserVoice
+/// Voice of the pool, rendered in a lane of the processor's VoiceBank: its envelopes, mix and filter run
+/// in the lane group with the other voices of the group, the voice renders its oscillators and modulation.
+class synthVoice : public juce::SynthesiserVoice, public BankVoice
 {
 public:
 
-    void setParametersFromApvts(juce::AudioProcessorValueTreeState& apvts) 
-    {   //AMP ADSR PARAMETER
-        attackParam[0] = apvts.getRawParameterValue("attack1");
-        decayParam[0] = apvts.getRawParameterValue("decay1");
-        sustainParam[0] = apvts.getRawParameterValue("sustain1");
-        releaseParam[0] = apvts.getRawParameterValue("release1");
-
-        attackParam[1] = apvts.getRawParameterValue("attack2");
-        decayParam[1] = apvts.getRawParameterValue("decay2");
-        sustainParam[1] = apvts.getRawParameterValue("sustain2");
-        releaseParam[1] = apvts.getRawParameterValue("release2");
-
-
-        //OSC PARAMETER
-        OscWaveshapeParam[0] = apvts.getRawParameterValue("Osc1Waveshape");
-        OscWaveshapeParam[1] = apvts.getRawParameterValue("Osc2Waveshape");
-
-        UnisonParam[0] = apvts.getRawParameterValue("Osc1Unison");
-        UnisonParam[1] = apvts.getRawParameterValue("Osc2Unison");
-        DetuneParam[0] = apvts.getRawParameterValue("Osc1Detune");
-        DetuneParam[1] = apvts.getRawParameterValue("Osc2Detune");
-
-        Level[0] = apvts.getRawParameterValue("level1");
-        Level[1] = apvts.getRawParameterValue("level2");
-        
-
-        //filter
-        filterOn = apvts.getRawParameterValue("FilterOn");
-        filterType = apvts.getRawParameterValue("filterType");
-        cutoffParam = apvts.getRawParameterValue("cutOff");
-        QParam = apvts.getRawParameterValue("Q");
+    /// read the parameters from the snapshot filled by the processor once per block
+    /// @param SynthParameters*, snapshot owned by the processor, shared by all voices
+    void setParameters(const SynthParameters* _params)
+    {
+        params = _params;
+    }
 
-        //LFO
-        lfoDestinationParam[0] = apvts.getRawParameterValue("LFO1Destination");
-        lfoWaveshapeParam[0] = apvts.getRawParameterValue("LFO1Waveshape");
-        lfoFreqParam[0] = apvts.getRawParameterValue("LFO1FreqParam");
-        lfoAmountParam[0] = apvts.getRawParameterValue("LFO1AmountParam");
+    /// render the voice in a lane of the bank, call it once for every voice of the pool
+    /// @param VoiceBank&, bank owned by the processor
+    /// @param int, voice index in the pool
+    void setVoiceBank(VoiceBank& _bank, int _voiceIndex)
+    {
+        group = &_bank.getGroup(VoiceBank::getGroupIndex(_voiceIndex));
+        lane = _voiceIndex % VoiceBank::laneWidth;
+        group->setVoice(lane, this);
+    }
 
-        lfoDestinationParam[1] = apvts.getRawParameterValue("LFO2Destination");
-        lfoWaveshapeParam[1] = apvts.getRawParameterValue("LFO2Waveshape");
-        lfoFreqParam[1] = apvts.getRawParameterValue("LFO2FreqParam");
-        lfoAmountParam[1] = apvts.getRawParameterValue("LFO2AmountParam");
+    /// share the processor's filter coefficient table
+    void setFilterCoefficientCache(const FilterCoefficientCache* _coefficientCache)
+    {
+        filter.setCoefficientCache(_coefficientCache);
+    }
 
+    /// share the processor's band-limited wavetables
+    void setWavetables(const WavetableSet* _wavetables)
+    {
+        Osc1.setWavetables(_wavetables);
+        Osc2.setWavetables(_wavetables);
+        Uni1.setWavetables(_wavetables);
+        Uni2.setWavetables(_wavetables);
     }
 
     void startNote(int midiNoteNumber,
@@ -85,53 +83,41 @@ public:
         juce::SynthesiserSound* sound,
         int currentPitchWheelPosition) override 
     {
-        playing = true;
-        float freq = juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber);
+        // the correctly rounded frequency of a whole note, as juce::MidiMessage::getMidiNoteInHertz();
+        // the oscillators play it truncated to whole Hz, as the original voice does, the precise tier
+        // only makes sure a note on a whole frequency (A4, 440 Hz) is not truncated to the Hz below
+        float freq = FastMath::pitchToFrequency<FastMath::precise>((float) midiNoteNumber);
 
         // Osc setting prepare
-        Osc1.startNote(getSampleRate(), *OscWaveshapeParam[0], freq);
-        Osc2.startNote(getSampleRate(), *OscWaveshapeParam[1], freq);
+        Osc1.startNote(getSampleRate(), params->oscWaveshape[0], (int) freq);
+        Osc2.startNote(getSampleRate(), params->oscWaveshape[1], (int) freq);
 
         // DetuneParam get the percentage(0-100%), here *0.1 convert it to 0-10 Hz detune amount
         // e.g. We got fundamental freq base on midinote, then +10Hz +20Hz +30Hz +40Hz(if user selected 4 unison and 100% Detune) 
-        for (int i = 1; i < *UnisonParam[0] +1; i++)
-        {
-            Uni1[i].startNote(getSampleRate(), *OscWaveshapeParam[0], freq + 0.1* (*DetuneParam[0]) * i);
-        }
-
-        
-        for (int i = 1; i < *UnisonParam[1] + 1; i++)
-        {
-            Uni2[i].startNote(getSampleRate(), *OscWaveshapeParam[1], freq + 0.1 * (*DetuneParam[1]) * i);
-        }
-
-
-        env1.setSampleRate(getSampleRate());
-        env2.setSampleRate(getSampleRate());
-
+        Uni1.startNote(getSampleRate(), params->oscWaveshape[0], freq, params->detune[0], params->unison[0]);
+        Uni2.startNote(getSampleRate(), params->oscWaveshape[1], freq, params->detune[1], params->unison[1]);
 
-        juce::ADSR::Parameters envPara1, envPara2;
-        envPara1.attack = *attackParam[0];
-        envPara1.decay = *decayParam[0];
-        envPara1.sustain = *sustainParam[0];
-        envPara1.release = *releaseParam[0];
-
-        envPara2.attack = *attackParam[1];
-        envPara2.decay = *decayParam[1];
-        envPara2.sustain = *sustainParam[1];
-        envPara2.release = *releaseParam[1];
-
-        env1.setParameters(envPara1);
-        env1.noteOn();
-
-        env2.setParameters(envPara2);
-        env2.noteOn();
         //filter setting prepare
-        filter.startNote(getSampleRate(), *cutoffParam, *QParam, *filterType);
+        filter.startNote(getSampleRate(), params->cutoff, params->Q, params->filterType);
+
+        // the envelopes and the filter state live in the voice's lane
+        group->startNote(lane, getSampleRate(), params->envelope[0], params->envelope[1]);
+        if (filter.isStateVariable())
+            group->setFilterCoefficients(lane, filter.getStateVariableCoefficients());
+        else
+            group->setFilterCoefficients(lane, filter.getCoefficients());
 
         //LFO setting prepare
-        lfo1.startNote(getSampleRate(), *lfoWaveshapeParam[0], *lfoFreqParam[0], *lfoAmountParam[0]);
-        lfo2.startNote(getSampleRate(), *lfoWaveshapeParam[1], *lfoFreqParam[1], *lfoAmountParam[1]);
+        lfo1.startNote(getSampleRate(), params->lfoWaveshape[0], params->lfoFreq[0], params->lfoAmount[0]);
+        lfo2.startNote(getSampleRate(), params->lfoWaveshape[1], params->lfoFreq[1], params->lfoAmount[1]);
+
+        osc1FreqMod.reset();
+        osc2FreqMod.reset();
+        osc1PhaseMod.reset();
+        osc2PhaseMod.reset();
+        filterCutoffMod.reset();
+        samplesUntilModulationUpdate = 0;
+        samplesUntilFilterUpdate = 0;
         
         
   
@@ -142,8 +128,7 @@ public:
     void stopNote(float velocity, bool allowTailOff) override
     {
         DBG("NOTE STOPPED");
-        env1.noteOff();
-        env2.noteOff();
+        group->stopNote(lane);
 
      }
 
@@ -151,124 +136,65 @@ public:
         int startSample,
         int numSamples) override
     {
-        if (playing)
-        {
-            // DSP LOOP 
-
-            //for each sample
-            for (int i = startSample; i < startSample+numSamples; i++)
-            {
-
-                // Process Unison
-                //Reset UnisonSample 
-                UniSample1 = 0;
-                UniSample2 = 0;
-
+        // synthEngine renders the voices through their lane groups, a voice has no signal of its own
+        juce::ignoreUnused(outputBuffer, startSample, numSamples);
+    }
 
-                for (int i = 1; i < *UnisonParam[0] + 1; i++)
-                {
-                    UniSample1 +=  Uni1[i].process();
-                }
+    bool isLaneActive() const override
+    {
+        return isVoiceActive();
+    }
 
+    void renderChunk(VoiceLane& _lane) override
+    {
+        // DSP LOOP 
+        stageTimer.start();
+
+        // the group has rendered the envelopes, the chunk ends where both have ended
+        const int blockPosition = _lane.getBlockPosition();
+        const int chunkLength = _lane.getNumSamples();
+
+        // Unison voices are rendered a chunk at a time by the SIMD banks,
+        // the main oscillators one control period at a time by the block kernels
+        // the unison banks follow the pitch wheel sample by sample, like the main oscillators
+        const float* pitchBend = params->pitchBend != nullptr ? params->pitchBend + blockPosition : nullptr;
+        Uni1.process(UniBuffer1, chunkLength, pitchBend);
+        Uni2.process(UniBuffer2, chunkLength, pitchBend);
+        stageTimer.lap(DspStage::unison);
+
+        //Apply LFO
+        // LFOs and their destinations are evaluated at control rate, every
+        // controlInterval samples, and the oscillator offsets are ramped in between.
+        // The updates falling in the chunk are computed together through the modulation matrix.
+        const int interval = ControlRate::getInterval(params->modulationRate);
+        computeModulation(blockPosition, chunkLength, interval);
+        stageTimer.lap(DspStage::modulation);
+
+        for (int pos = 0, update = 0; pos < chunkLength;)
+        {
+            if (samplesUntilModulationUpdate <= 0)
+            {
+                samplesUntilModulationUpdate = interval;
+                applyModulation(update++, interval);
+            }
 
-                for (int i = 1; i < *UnisonParam[1] + 1; i++)
-                {
-                    UniSample2 += Uni2[i].process();
-                }
-                
-                
-                //Apply LFO
-                //get LFO sample
-                int lfo1Destination = *lfoDestinationParam[0];
-                int lfo2Destination = *lfoDestinationParam[1];
-
-                float lfo1Sample = lfo1.process();
-                float lfo2Sample = lfo2.process();
-
-
-
-                // Osc's Amp Modulated by a LFO
-                if (lfo1.isAppliedToOsc1AM(lfo1Destination))
-                    Osc1.setAmplitudeOffset(lfo1Sample);
-                if (lfo2.isAppliedToOsc1AM(lfo2Destination))
-                    Osc1.setAmplitudeOffset(lfo2Sample);
-                if (lfo1.isAppliedToOsc2AM(lfo1Destination))
-                    Osc2.setAmplitudeOffset(lfo1Sample);
-                if (lfo2.isAppliedToOsc2AM(lfo2Destination))
-                    Osc2.setAmplitudeOffset(lfo2Sample);
-
-                // Osc's Freq Modulated by a LFO
-                // LFO Original Value:-1 to 1
-                // Times Amount value(in LFO.h) gives 0 or -100 to 100 (namely lfo1Sample's value here)
-                // Here Times 5, so that we can control the frequency to increase or decrease by 500 Hz.
-                if (lfo1.isAppliedToOsc1FM(lfo1Destination))
-                    Osc1.setFreqOffset(5* lfo1Sample);
-                if (lfo2.isAppliedToOsc1FM(lfo2Destination))
-                    Osc1.setFreqOffset(5* lfo2Sample);
-                if (lfo1.isAppliedToOsc2FM(lfo1Destination))
-                    Osc2.setFreqOffset(5* lfo1Sample);
-                if (lfo2.isAppliedToOsc2FM(lfo2Destination))
-                    Osc2.setFreqOffset(5* lfo2Sample);
-
-
-                // Osc's Phase Modulated by a LFO          
-                if (lfo1.isAppliedToOsc1PM(lfo1Destination))
-                    Osc1.setAmplitudeOffset(lfo1Sample);
-                if (lfo2.isAppliedToOsc1PM(lfo2Destination))
-                    Osc1.setAmplitudeOffset(lfo2Sample);
-                if (lfo1.isAppliedToOsc2PM(lfo1Destination))
-                    Osc2.setAmplitudeOffset(lfo1Sample);
-                if (lfo2.isAppliedToOsc2PM(lfo2Destination))
-                    Osc2.setAmplitudeOffset(lfo2Sample);
-
-
-                // Filter's cutoffFrequency modulation(by a LFO)
-                // LFO Original Value:-1 to 1
-                // Times Amount value(in LFO.h) gives 0 or -100 to 100 (namely lfo1Sample's value here)
-                // Here Times 7, so that we can control the cut-off frequency to increase or decrease by 700 Hz.
-                if (lfo1.isAppliedToFilterCutoffFreq(lfo1Destination))
-                    filter.setFrequencyOffset(7* lfo1Sample);
-                if (lfo2.isAppliedToFilterCutoffFreq(lfo2Destination))
-                    filter.setFrequencyOffset(7* lfo2Sample);
-
-
-                // Normalise the results
-                float outputSample1 = (Osc1.process() + UniSample1) / (*UnisonParam[0] + 1);
-                float outputSample2 = (Osc2.process() + UniSample2) / (*UnisonParam[1] + 1);
-
-
-                // Level Control and output
-                float Osc1level = *Level[0];
-                float Osc2level = *Level[1];
-
-                float envvalue1 = env1.getNextSample();
-                float envvalue2 = env2.getNextSample();
-
-                float outputSample = envvalue1 * Osc1level * outputSample1 + envvalue2 * Osc2level * outputSample2;
-
-                // Process Filter
-                if (*filterOn == true)
-                {
-                    outputSample = filter.process(outputSample, *filterType);
+            const int segmentLength = juce::jmin(chunkLength - pos, samplesUntilModulationUpdate);
+            if (params->filterOn)
+                rampFilter(_lane, pos, segmentLength);
+            renderSegment(_lane, blockPosition + pos, pos, segmentLength);
 
-                }
-                
-   
-                //for each channel
-                for (int chan = 0; chan < outputBuffer.getNumChannels(); chan++)
-                {
-                    outputBuffer.addSample(chan, i, outputSample * 0.1);
-                }
+            samplesUntilModulationUpdate -= segmentLength;
+            pos += segmentLength;
+        }
 
+        // the segments are timed together, a counter read per control period would cost as much as the short ones
+        stageTimer.lap(DspStage::oscillators);
+    }
 
-                // When both of the Osc's life cycle end, clear notes
-                if (!env1.isActive() && !env2.isActive() )
-                {
-                    playing = false;
-                    clearCurrentNote();
-                }
-            }
-        }
+    void laneEnded() override
+    {
+        // When both of the Osc's life cycle end, clear notes
+        clearCurrentNote();
     }
 
     bool canPlaySound(juce::SynthesiserSound*)override
@@ -292,41 +218,412 @@ public:
 
 
 private:
-    juce::Random random;
-    bool playing = true;
-    Filter filter;
+    /// render the oscillators of the samples between two modulation updates into the lane
+    /// @param VoiceLane&, the voice's lane for the chunk
+    /// @param int, position of the segment in the processed block (per-sample parameters)
+    /// @param int, offset of the segment inside the current chunk (UniBuffer1/UniBuffer2)
+    /// @param int, number of samples
+    void renderSegment(VoiceLane& _lane, int blockPosition, int chunkOffset, int numSamples)
+    {
+        renderOscillators(blockPosition, numSamples);
+
+        //for each sample
+        // Normalise the results, the lane group applies the envelopes and levels
+        for (int i = 0; i < numSamples; i++)
+        {
+            float outputSample1 = (OscBuffer1[i] + UniBuffer1[chunkOffset + i]) / (Uni1.getNumVoices() + 1);
+            float outputSample2 = (OscBuffer2[i] + UniBuffer2[chunkOffset + i]) / (Uni2.getNumVoices() + 1);
+
+            _lane.setOscillators(chunkOffset + i, outputSample1, outputSample2);
+        }
+    }
+
+    /// render the main oscillators of a segment into OscBuffer1/OscBuffer2, with the LFO frequency and
+    /// phase offsets ramped per sample and the audio-rate cross modulation added to the carrier's offsets
+    /// @param int, position of the segment in the processed block (pitch wheel, cross modulation depth)
+    /// @param int, number of samples
+    void renderOscillators(int blockPosition, int numSamples)
+    {
+        OscSwitch* oscs[] = { &Osc1, &Osc2 };
+        float* buffers[] = { OscBuffer1, OscBuffer2 };
+        float* freqOffsets[] = { OscFreqOffsets1, OscFreqOffsets2 };
+        float* phaseBuffers[] = { OscPhaseOffsets1, OscPhaseOffsets2 };
+        const float* phaseOffsets[] = { nullptr, nullptr };
+
+        for (int i = 0; i < numSamples; i++)
+        {
+            OscFreqOffsets1[i] = osc1FreqMod.getNextValue();
+            OscFreqOffsets2[i] = osc2FreqMod.getNextValue();
+        }
+
+        // the pitch wheel scales the whole frequency, LFO offset included
+        if (params->pitchBend != nullptr)
+        {
+            const float* ratio = params->pitchBend + blockPosition;
+            for (int o = 0; o < 2; o++)
+            {
+                const float base = oscs[o]->getFreqBase();
+                for (int i = 0; i < numSamples; i++)
+                    freqOffsets[o][i] = (base + freqOffsets[o][i]) * ratio[i] - base;
+            }
+        }
+
+        // the phase kernels only run for an oscillator whose phase is modulated
+        const ModulationMatrix::Destination phaseDestinations[] = { ModulationMatrix::osc1Phase, ModulationMatrix::osc2Phase };
+        ControlRateRamp* phaseRamps[] = { &osc1PhaseMod, &osc2PhaseMod };
+        for (int o = 0; o < 2; o++)
+        {
+            if (params->modulation.isModulated(phaseDestinations[o]))
+            {
+                for (int i = 0; i < numSamples; i++)
+                    phaseBuffers[o][i] = phaseRamps[o]->getNextValue();
+                phaseOffsets[o] = phaseBuffers[o];
+            }
+        }
+
+        const int mode = params->crossModulation;
+        if (mode == CrossModulation::off)
+        {
+            Osc1.process(OscBuffer1, OscFreqOffsets1, phaseOffsets[0], numSamples);
+            Osc2.process(OscBuffer2, OscFreqOffsets2, phaseOffsets[1], numSamples);
+            return;
+        }
+
+        // the modulator is rendered first, its samples are added to the carrier's offsets as one block
+        const int carrier = CrossModulation::getCarrier(mode);
+        const int modulator = 1 - carrier;
+        oscs[modulator]->process(buffers[modulator], freqOffsets[modulator], phaseOffsets[modulator], numSamples);
+
+        // the depth is ramped sample by sample, a change does not step the carrier's offsets
+        const float* depth = params->crossModulationDepth + blockPosition;
+        if (CrossModulation::isPhaseModulation(mode))
+        {
+            if (phaseOffsets[carrier] == nullptr)
+                juce::FloatVectorOperations::clear(phaseBuffers[carrier], numSamples);
+
+            juce::FloatVectorOperations::addWithMultiply(phaseBuffers[carrier], buffers[modulator], depth, numSamples);
+            phaseOffsets[carrier] = phaseBuffers[carrier];
+        }
+        else
+        {
+            const float base = oscs[carrier]->getFreqBase();
+            for (int i = 0; i < numSamples; i++)
+                freqOffsets[carrier][i] += buffers[modulator][i] * (depth[i] * base);
+        }
+
+        oscs[carrier]->process(buffers[carrier], freqOffsets[carrier], phaseOffsets[carrier], numSamples);
+    }
+
+    /// advance both LFOs to every modulation update of a chunk and route them to the destinations
+    /// @param int, position of the chunk in the processed block (global LFOs)
+    /// @param int, number of samples in the chunk
+    /// @param int, samples between two updates (1 reproduces the per-sample path)
+    void computeModulation(int _blockPosition, int _chunkLength, int _interval)
+    {
+        // the first update is due after the samples left from the previous period
+        const int first = juce::jmax(0, samplesUntilModulationUpdate);
+        const int numUpdates = first < _chunkLength ? 1 + (_chunkLength - 1 - first) / _interval : 0;
+
+        LFO* lfos[] = { &lfo1, &lfo2 };
+        const ModulationMatrix::Source lfoSources[] = { ModulationMatrix::lfo1, ModulationMatrix::lfo2 };
+
+        for (int i = 0; i < 2; i++)
+        {
+            float* values = modSources[lfoSources[i]];
+
+            // a global LFO is rendered once per block by the processor, the voice reads its value
+            // at the end of each period, or at the end of the block for a period that runs past it
+            if (const float* block = params->lfoBlock[i])
+            {
+                for (int k = 0; k < numUpdates; k++)
+                    values[k] = block[juce::jmin(_blockPosition + first + (k + 1) * _interval, params->numSamples) - 1];
+            }
+            else
+            {
+                for (int k = 0; k < numUpdates; k++)
+                    values[k] = lfos[i]->process(_interval);
+            }
+        }
+
+        const float* sources[ModulationMatrix::numSources];
+        float* destinations[ModulationMatrix::numDestinations];
+        for (int i = 0; i < ModulationMatrix::numSources; i++)
+            sources[i] = modSources[i];
+        for (int i = 0; i < ModulationMatrix::numDestinations; i++)
+            destinations[i] = modDestinations[i];
+
+        params->modulation.process(sources, destinations, numUpdates);
+    }
+
+    /// set the modulation targets reached at the end of a control period
+    /// @param int, index of the update in the chunk (computeModulation)
+    /// @param int, number of samples until the next update
+    void applyModulation(int _update, int _numSamples)
+    {
+        // amplitude offsets are stored by the oscillators but not applied yet (as in Phasor),
+        // so there is nothing to ramp
+        Osc1.setAmplitudeOffset(modDestinations[ModulationMatrix::osc1Amp][_update]);
+        Osc2.setAmplitudeOffset(modDestinations[ModulationMatrix::osc2Amp][_update]);
+        osc1FreqMod.setTarget(modDestinations[ModulationMatrix::osc1Freq][_update], _numSamples);
+        osc2FreqMod.setTarget(modDestinations[ModulationMatrix::osc2Freq][_update], _numSamples);
+        osc1PhaseMod.setTarget(modDestinations[ModulationMatrix::osc1Phase][_update], _numSamples);
+        osc2PhaseMod.setTarget(modDestinations[ModulationMatrix::osc2Phase][_update], _numSamples);
+
+        // the cutoff is ramped too, rampFilter() follows the ramp with new coefficients
+        filterCutoffMod.setTarget(modDestinations[ModulationMatrix::filterCutoff][_update], _numSamples);
+        samplesUntilFilterUpdate = 0;
+    }
+
+    /// recalculate the filter coefficients along the cutoff ramp, every filterUpdateInterval samples
+    /// of a control period, and queue them in the lane. Filter coefficients are the expensive part,
+    /// so the cutoff steps at this interval instead of every sample; a step of a few samples is inaudible,
+    /// one per control period (up to 64 samples) zips on a fast sweep.
+    /// @param VoiceLane&, the voice's lane for the chunk
+    /// @param int, offset of the samples inside the current chunk
+    /// @param int, number of samples, all of them in the current control period
+    void rampFilter(VoiceLane& _lane, int _position, int _numSamples)
+    {
+        for (int i = 0; i < _numSamples;)
+        {
+            if (samplesUntilFilterUpdate <= 0)
+            {
+                // the coefficients of a step are those of the cutoff reached at its end, a step never
+                // runs past the control period so the last one reaches the period's target
+                samplesUntilFilterUpdate = juce::jmin(filterUpdateInterval, samplesUntilModulationUpdate - i);
+                filter.setFrequencyOffset(filterCutoffMod.skip(samplesUntilFilterUpdate));
+                filter.updateCoefficients(params->filterType);
+
+                if (filter.isStateVariable())
+                    _lane.setFilterCoefficients(_position + i, filter.getStateVariableCoefficients());
+                else
+                    _lane.setFilterCoefficients(_position + i, filter.getCoefficients());
+            }
+
+            const int length = juce::jmin(_numSamples - i, samplesUntilFilterUpdate);
+            samplesUntilFilterUpdate -= length;
+            i += length;
+        }
+    }
+
+    VoiceLaneGroup* group = nullptr;                         // lane group of the voice in the processor's VoiceBank
+    int lane = 0;
+    Filter filter;                                           // calculates the coefficients, the lane holds the state
     LFO lfo1, lfo2;
     OscSwitch Osc1, Osc2;
-    OscSwitch Uni1[7],Uni2[7];                               // For Osc1's Unison Effect
+    UnisonBank Uni1, Uni2;                                   // For Osc1's and Osc2's Unison Effect
 
-    float UniSample1, UniSample2;
-    juce::ADSR env1, env2;
+    static constexpr int renderChunkSize = VoiceLaneGroup::chunkSize;   // samples rendered per call to the unison banks
+    float UniBuffer1[renderChunkSize], UniBuffer2[renderChunkSize];
+    float OscBuffer1[renderChunkSize], OscBuffer2[renderChunkSize];
+    float OscFreqOffsets1[renderChunkSize], OscFreqOffsets2[renderChunkSize];
+    float OscPhaseOffsets1[renderChunkSize], OscPhaseOffsets2[renderChunkSize];
 
-    //parameters
-    std::atomic<float>* attackParam[2];
-    std::atomic<float>* decayParam[2];
-    std::atomic<float>* sustainParam[2];
-    std::atomic<float>* releaseParam[2];
+    // Control-rate modulation, one value per update of the current chunk
+    float modSources[ModulationMatrix::numSources][renderChunkSize];
+    float modDestinations[ModulationMatrix::numDestinations][renderChunkSize];
+    ControlRateRamp osc1FreqMod, osc2FreqMod;
+    ControlRateRamp osc1PhaseMod, osc2PhaseMod;
+    ControlRateRamp filterCutoffMod;
+    int samplesUntilModulationUpdate = 0;
+    static constexpr int filterUpdateInterval = 8;           // samples between two coefficient updates of a cutoff ramp
+    int samplesUntilFilterUpdate = 0;
 
-    // Osc and Unison
-    std::atomic<float>* OscWaveshapeParam[2];
-    std::atomic<float>* Level[2];
-    std::atomic<float>* UnisonParam[2];             // define the num of unison
-    std::atomic<float>* DetuneParam[2];             // store the detune amount in percentage
+    const SynthParameters* params = nullptr;        // parameters of the current block
 
 
+};
+
+/// Synthesiser with a voice pool allocated up front (maxVoices) of which only the first
+/// "Polyphony" voices are used for new notes. The voices are rendered by the lane groups of a VoiceBank,
+/// groups without a sounding voice are skipped entirely, so the cost of a block depends on the number
+/// of sounding voices, in steps of the SIMD width, not on the size of the pool.
+class synthEngine : public juce::Synthesiser
+{
+public:
+    static constexpr int maxVoices = 128;
+
+    /// set how many voices of the pool can be given new notes, voices above the limit finish their release
+    /// @param int, number of voices (1 - maxVoices)
+    void setPolyphony(int _polyphony)
+    {
+        polyphony = juce::jlimit(1, juce::jmin(maxVoices, getNumVoices()), _polyphony);
+    }
+
+    int getPolyphony() const
+    {
+        return polyphony;
+    }
+
+    /// check if any voice of the pool is playing or releasing
+    bool hasActiveVoices() const
+    {
+        for (int i = 0; i < getNumVoices(); i++)
+            if (getVoice(i)->isVoiceActive())
+                return true;
 
-    // Filter Parameters
-    std::atomic<float>* filterOn;
-    std::atomic<float>* filterType;
-    std::atomic<float>* cutoffParam;
-    std::atomic<float>* QParam;
+        return false;
+    }
 
-    // LFO Parameters
-    std::atomic<float>* lfoDestinationParam[2];     // LFOs destinations
-    std::atomic<float>* lfoWaveshapeParam[2];       // LFOs waveshapes
-    std::atomic<float>* lfoFreqParam[2];            // LFOs rate
-    std::atomic<float>* lfoAmountParam[2];          // LFOs amount
+    /// render the active voices on worker threads, nullptr renders them on the calling thread
+    /// @param ParallelVoiceRenderer*, renderer owned by the processor
+    void setParallelRenderer(ParallelVoiceRenderer* _renderer)
+    {
+        parallelRenderer = _renderer;
+    }
 
+    /// collect the stage timings of the rendered voices, nullptr stops collecting them
+    /// @param DspProfiler*, profiler owned by the processor
+    void setProfiler(DspProfiler* _profiler)
+    {
+        profiler = _profiler;
+    }
+
+    /// render the voices into a preallocated arena
+    /// @param VoiceScratchArena*, arena owned by the processor, one block per voice of the pool
+    void setScratchArena(VoiceScratchArena* _arena)
+    {
+        arena = _arena;
+    }
+
+    /// render the voices through the lane groups of a bank, every voice of the pool must have its lane (synthVoice::setVoiceBank())
+    /// @param VoiceBank*, bank owned by the processor
+    void setVoiceBank(VoiceBank* _bank)
+    {
+        bank = _bank;
+    }
+
+protected:
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override
+    {
+        if (arena == nullptr || bank == nullptr || arena->getNumVoices() < getNumVoices())
+            return;
+
+        if (arena->covers(startSample, numSamples))
+        {
+            renderGroups(outputAudio, startSample, numSamples, startSample);
+            return;
+        }
+
+        // a block longer than the arena was prepared for is rendered in parts from the start of the blocks
+        for (int done = 0; done < numSamples; done += arena->getBlockSize())
+            renderGroups(outputAudio, startSample + done, juce::jmin(arena->getBlockSize(), numSamples - done), 0);
+    }
+
+    juce::SynthesiserVoice* findFreeVoice(juce::SynthesiserSound* soundToPlay, int midiChannel, int midiNoteNumber, bool stealIfNoneAvailable) const override
+    {
+        for (int i = 0; i < polyphony; i++)
+        {
+            auto* voice = getVoice(i);
+            if (!voice->isVoiceActive() && voice->canPlaySound(soundToPlay))
+                return voice;
+        }
+
+        if (stealIfNoneAvailable)
+            return findVoiceToSteal(soundToPlay, midiChannel, midiNoteNumber);
+
+        return nullptr;
+    }
+
+    juce::SynthesiserVoice* findVoiceToSteal(juce::SynthesiserSound* soundToPlay, int, int) const override
+    {
+        // prefer the oldest voice whose key is already released, otherwise the oldest voice
+        juce::SynthesiserVoice* oldestReleased = nullptr;
+        juce::SynthesiserVoice* oldest = nullptr;
+
+        for (int i = 0; i < polyphony; i++)
+        {
+            auto* voice = getVoice(i);
+            if (!voice->canPlaySound(soundToPlay))
+                continue;
+
+            if (voice->isPlayingButReleased() && (oldestReleased == nullptr || voice->wasStartedBefore(*oldestReleased)))
+                oldestReleased = voice;
+
+            if (oldest == nullptr || voice->wasStartedBefore(*oldest))
+                oldest = voice;
+        }
+
+        return oldestReleased != nullptr ? oldestReleased : oldest;
+    }
+
+private:
+    /// render the lane groups of the active voices into the arena and add the voices to the output
+    /// @param juce::AudioBuffer<float>&, output
+    /// @param int, first sample in the output (and in the processed block)
+    /// @param int, number of samples
+    /// @param int, first sample in the arena's blocks
+    void renderGroups(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples, int arenaOffset)
+    {
+        int numActive = 0;
+        int numGroups = 0;
+        for (int i = 0; i < getNumVoices() && numActive < maxVoices; i++)
+        {
+            auto* voice = getVoice(i);
+            if (voice->isVoiceActive())
+            {
+                activeVoices[(size_t) numActive] = dynamic_cast<BankVoice*>(voice);
+                activeBlocks[(size_t) numActive] = arena->getVoiceBlock(i) + arenaOffset;
+                jassert(activeVoices[(size_t) numActive] != nullptr);
+                numActive++;
+
+                // the lanes of a group render into consecutive blocks, from the block of its first voice
+                const int group = VoiceBank::getGroupIndex(i);
+                if (numGroups == 0 || activeGroupIndices[(size_t) numGroups - 1] != group)
+                {
+                    activeGroupIndices[(size_t) numGroups] = group;
+                    activeGroups[(size_t) numGroups] = &bank->getGroup(group);
+                    groupBlocks[(size_t) numGroups] = arena->getVoiceBlock(group * VoiceBank::laneWidth) + arenaOffset;
+                    numGroups++;
+                }
+            }
+        }
+
+        if (numActive == 0)
+            return;
+
+        // the voices read the cycle counter only in the blocks the profiler times
+        const bool timing = profiler != nullptr && profiler->isTiming();
+        for (int i = 0; i < numActive; i++)
+            activeVoices[(size_t) i]->stageTimer.setEnabled(timing);
+        for (int i = 0; i < numGroups; i++)
+            activeGroups[(size_t) i]->stageTimer.setEnabled(timing);
+
+        // the parallel renderer produces the same output, a single group is not worth handing off
+        if (parallelRenderer == nullptr || numGroups == 1
+            || !parallelRenderer->render(activeGroups.data(), groupBlocks.data(), numGroups, startSample, numSamples))
+        {
+            for (int i = 0; i < numGroups; i++)
+                activeGroups[(size_t) i]->renderMono(groupBlocks[(size_t) i], startSample, numSamples);
+        }
+
+        if (timing)
+        {
+            for (int i = 0; i < numActive; i++)
+                profiler->addVoice(activeVoices[(size_t) i]->stageTimer);
+            for (int i = 0; i < numGroups; i++)
+                profiler->addLaneGroup(activeGroups[(size_t) i]->stageTimer);
+        }
+
+        // sum the voices in voice order, then add the mono mix to every channel
+        float* mix = arena->getMixBlock() + arenaOffset;
+        juce::FloatVectorOperations::copy(mix, activeBlocks[0], numSamples);
+        for (int i = 1; i < numActive; i++)
+            juce::FloatVectorOperations::add(mix, activeBlocks[(size_t) i], numSamples);
+
+        for (int chan = 0; chan < outputAudio.getNumChannels(); chan++)
+            juce::FloatVectorOperations::add(outputAudio.getWritePointer(chan, startSample), mix, numSamples);
+    }
 
+    static constexpr int maxGroups = (maxVoices + VoiceBank::laneWidth - 1) / VoiceBank::laneWidth;
+
+    int polyphony = 4;
+    ParallelVoiceRenderer* parallelRenderer = nullptr;
+    VoiceScratchArena* arena = nullptr;
+    VoiceBank* bank = nullptr;
+    DspProfiler* profiler = nullptr;
+    std::array<BankVoice*, maxVoices> activeVoices {};   // voices rendered in the current block, in voice order
+    std::array<float*, maxVoices> activeBlocks {};       // their scratch blocks at the first sample
+    std::array<MonoVoice*, maxGroups> activeGroups {};   // lane groups of these voices, in order
+    std::array<float*, maxGroups> groupBlocks {};        // scratch block of each group's first lane
+    std::array<int, maxGroups> activeGroupIndices {};
 };
@@ -0,0 +1,281 @@
+/*
+  ==============================================================================
+
+    SynthParameters.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef SYNTH_PARAMETERS_H
+#define SYNTH_PARAMETERS_H
+
+#include <vector>
+#include <JuceHeader.h>
+#include "LFO.h"
+#include "ModulationMatrix.h"
+#include "PresetState.h"
+
+/// The parameters seen by the voices during one block.
+/// Every value is read once, from the block values of PresetSwap at the start of processBlock, so all voices work
+/// with the same values for the whole block and no atomic is touched inside the DSP loops.
+/// Continuous values that are applied on every sample (the oscillator levels and the cross modulation depth)
+/// are smoothed and handed over as one value per sample of the block. Detune, cutoff, Q and the amount of a
+/// per-voice LFO are not ramped: a voice takes them when its note starts, a change reaches the next notes.
+/// The amount of a global LFO changes once per block, the LFO's own output smoothing ramps the step.
+struct SynthParameters
+{
+    int numSamples = 0;                           // samples in the block
+
+    // Envelopes
+    juce::ADSR::Parameters envelope[2];
+
+    // Osc and Unison
+    int oscWaveshape[2] = { 0, 0 };
+    int unison[2] = { 0, 0 };                     // number of unison voices on top of the main oscillator
+    float detune[2] = { 0.0f, 0.0f };             // detune amount in percentage
+    const float* level[2] = { nullptr, nullptr }; // smoothed level, indexed by the sample of the block
+    int crossModulation = 0;                      // CrossModulation::Mode
+    const float* crossModulationDepth = nullptr;  // smoothed depth 0 - 1, indexed by the sample of the block
+
+    // Filter
+    bool filterOn = false;
+    int filterType = 0;
+    float cutoff = 0.0f;
+    float Q = 0.0f;
+
+    // LFO
+    int lfoDestination[2] = { 0, 0 };
+    int lfoWaveshape[2] = { 0, 0 };
+    float lfoFreq[2] = { 0.0f, 0.0f };
+    float lfoAmount[2] = { 0.0f, 0.0f };
+    const float* lfoBlock[2] = { nullptr, nullptr }; // global LFO, indexed by the sample of the block, nullptr when retriggered per voice
+    int modulationRate = 0;                       // ControlRate choice
+    const float* pitchBend = nullptr;             // pitch wheel frequency ratio, indexed by the sample of the block, nullptr when centred
+    ModulationMatrix modulation;                  // LFO routing, compiled when the destinations change
+};
+
+/// Fills a SynthParameters snapshot from the parameter values of the block, owned by the processor and shared by every voice.
+class ParameterSnapshot
+{
+public:
+    static constexpr double smoothingTime = 0.02;  // seconds to reach a new level
+
+    /// look up the parameters, call it once from the processor constructor
+    /// @param PresetSwap&, parameter values of the block
+    void attach(const PresetSwap& _values)
+    {
+        //AMP ADSR PARAMETER
+        attackParam[0] = _values.getRawParameterValue("attack1");
+        decayParam[0] = _values.getRawParameterValue("decay1");
+        sustainParam[0] = _values.getRawParameterValue("sustain1");
+        releaseParam[0] = _values.getRawParameterValue("release1");
+
+        attackParam[1] = _values.getRawParameterValue("attack2");
+        decayParam[1] = _values.getRawParameterValue("decay2");
+        sustainParam[1] = _values.getRawParameterValue("sustain2");
+        releaseParam[1] = _values.getRawParameterValue("release2");
+
+        //OSC PARAMETER
+        OscWaveshapeParam[0] = _values.getRawParameterValue("Osc1Waveshape");
+        OscWaveshapeParam[1] = _values.getRawParameterValue("Osc2Waveshape");
+
+        UnisonParam[0] = _values.getRawParameterValue("Osc1Unison");
+        UnisonParam[1] = _values.getRawParameterValue("Osc2Unison");
+        DetuneParam[0] = _values.getRawParameterValue("Osc1Detune");
+        DetuneParam[1] = _values.getRawParameterValue("Osc2Detune");
+
+        Level[0] = _values.getRawParameterValue("level1");
+        Level[1] = _values.getRawParameterValue("level2");
+
+        crossModulationParam = _values.getRawParameterValue("OscCrossMod");
+        crossModulationDepthParam = _values.getRawParameterValue("OscCrossModDepth");
+
+        //filter
+        filterOn = _values.getRawParameterValue("FilterOn");
+        filterType = _values.getRawParameterValue("filterType");
+        cutoffParam = _values.getRawParameterValue("cutOff");
+        QParam = _values.getRawParameterValue("Q");
+
+        //LFO
+        lfoDestinationParam[0] = _values.getRawParameterValue("LFO1Destination");
+        lfoWaveshapeParam[0] = _values.getRawParameterValue("LFO1Waveshape");
+        lfoFreqParam[0] = _values.getRawParameterValue("LFO1FreqParam");
+        lfoAmountParam[0] = _values.getRawParameterValue("LFO1AmountParam");
+        lfoModeParam[0] = _values.getRawParameterValue("LFO1Mode");
+
+        lfoDestinationParam[1] = _values.getRawParameterValue("LFO2Destination");
+        lfoWaveshapeParam[1] = _values.getRawParameterValue("LFO2Waveshape");
+        lfoFreqParam[1] = _values.getRawParameterValue("LFO2FreqParam");
+        lfoAmountParam[1] = _values.getRawParameterValue("LFO2AmountParam");
+        lfoModeParam[1] = _values.getRawParameterValue("LFO2Mode");
+
+        modulationRateParam = _values.getRawParameterValue("ModulationRate");
+    }
+
+    /// allocate the per-sample buffers and jump the smoothers to the current values (prepareToPlay)
+    /// @param double, sample rate
+    /// @param int, maximum block size
+    void prepare(double _sampleRate, int _maxBlockSize)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            levelRamp[i].assign((size_t) juce::jmax(1, _maxBlockSize), 0.0f);
+            smoothedLevel[i].reset(_sampleRate, smoothingTime);
+            smoothedLevel[i].setCurrentAndTargetValue(Level[i]->load());
+
+            lfoRamp[i].assign((size_t) juce::jmax(1, _maxBlockSize), 0.0f);
+            globalWaveshape[i] = (int) lfoWaveshapeParam[i]->load();
+            globalLFO[i].startNote((float) _sampleRate, globalWaveshape[i], lfoFreqParam[i]->load(), lfoAmountParam[i]->load());
+        }
+
+        crossModulationRamp.assign((size_t) juce::jmax(1, _maxBlockSize), 0.0f);
+        smoothedCrossModulationDepth.reset(_sampleRate, smoothingTime);
+        smoothedCrossModulationDepth.setCurrentAndTargetValue(crossModulationDepthParam->load() * 0.01f);
+
+        update(0);
+    }
+
+    /// read every parameter once and render the smoothed values for the block (start of processBlock)
+    /// @param int, number of samples in the block, at most the size given to prepare()
+    void update(int _numSamples)
+    {
+        // the processor splits longer host blocks into parts of the prepared size
+        jassert(_numSamples <= (int) levelRamp[0].size());
+
+        snapshot.numSamples = _numSamples;
+
+        for (int i = 0; i < 2; i++)
+        {
+            snapshot.envelope[i].attack = attackParam[i]->load();
+            snapshot.envelope[i].decay = decayParam[i]->load();
+            snapshot.envelope[i].sustain = sustainParam[i]->load();
+            snapshot.envelope[i].release = releaseParam[i]->load();
+
+            snapshot.oscWaveshape[i] = (int) OscWaveshapeParam[i]->load();
+            snapshot.unison[i] = (int) UnisonParam[i]->load();
+            snapshot.detune[i] = DetuneParam[i]->load();
+
+            smoothedLevel[i].setTargetValue(Level[i]->load());
+            for (int n = 0; n < _numSamples; n++)
+                levelRamp[i][(size_t) n] = smoothedLevel[i].getNextValue();
+            snapshot.level[i] = levelRamp[i].data();
+
+            snapshot.lfoDestination[i] = (int) lfoDestinationParam[i]->load();
+            snapshot.lfoWaveshape[i] = (int) lfoWaveshapeParam[i]->load();
+            snapshot.lfoFreq[i] = lfoFreqParam[i]->load();
+            snapshot.lfoAmount[i] = lfoAmountParam[i]->load();
+            snapshot.lfoBlock[i] = lfoModeParam[i]->load() >= 0.5f ? renderGlobalLFO(i, _numSamples) : nullptr;
+        }
+
+        snapshot.crossModulation = (int) crossModulationParam->load();
+        smoothedCrossModulationDepth.setTargetValue(crossModulationDepthParam->load() * 0.01f);
+        for (int n = 0; n < _numSamples; n++)
+            crossModulationRamp[(size_t) n] = smoothedCrossModulationDepth.getNextValue();
+        snapshot.crossModulationDepth = crossModulationRamp.data();
+
+        snapshot.filterOn = filterOn->load() >= 0.5f;
+        snapshot.filterType = (int) filterType->load();
+        snapshot.cutoff = cutoffParam->load();
+        snapshot.Q = QParam->load();
+
+        snapshot.modulationRate = (int) modulationRateParam->load();
+
+        if (snapshot.lfoDestination[0] != routedDestination[0] || snapshot.lfoDestination[1] != routedDestination[1])
+            compileModulation();
+    }
+
+    /// hand the pitch wheel ramp of the block to the voices (MidiScheduler)
+    /// @param const float*, frequency ratio for every sample of the block, nullptr when centred
+    void setPitchBend(const float* _pitchBend)
+    {
+        snapshot.pitchBend = _pitchBend;
+    }
+
+    /// the snapshot, valid for the block after update()
+    const SynthParameters& get() const
+    {
+        return snapshot;
+    }
+
+private:
+    /// render one block of a free-running LFO shared by every voice, in place of one LFO per voice
+    /// @param int, LFO index
+    /// @param int, number of samples
+    /// @return const float*, LFO value of every sample of the block
+    const float* renderGlobalLFO(int _index, int _numSamples)
+    {
+        auto& lfo = globalLFO[_index];
+
+        // a new waveshape restarts the phase, only change it when the choice changes
+        if (snapshot.lfoWaveshape[_index] != globalWaveshape[_index])
+        {
+            globalWaveshape[_index] = snapshot.lfoWaveshape[_index];
+            lfo.setWaveshape(globalWaveshape[_index]);
+        }
+
+        lfo.setFrequency(snapshot.lfoFreq[_index]);
+        lfo.setAmount(snapshot.lfoAmount[_index]);
+        lfo.process(lfoRamp[_index].data(), _numSamples);
+
+        return lfoRamp[_index].data();
+    }
+
+    /// rebuild the routing table from the LFO destinations
+    void compileModulation()
+    {
+        snapshot.modulation.clear();
+
+        const ModulationMatrix::Source sources[] = { ModulationMatrix::lfo1, ModulationMatrix::lfo2 };
+        for (int i = 0; i < 2; i++)
+        {
+            ModulationMatrix::Destination destination;
+            float depth;
+            ModulationMatrix::getLFORoute(snapshot.lfoDestination[i], destination, depth);
+            snapshot.modulation.addRoute(sources[i], destination, depth);
+
+            routedDestination[i] = snapshot.lfoDestination[i];
+        }
+    }
+
+    SynthParameters snapshot;
+    int routedDestination[2] = { -1, -1 };        // LFO destinations the routing table was compiled for
+    LFO globalLFO[2];                             // "Global" LFO mode
+    int globalWaveshape[2] = { 0, 0 };
+    std::vector<float> lfoRamp[2];
+    std::vector<float> levelRamp[2];
+    juce::SmoothedValue<float> smoothedLevel[2];
+    std::vector<float> crossModulationRamp;
+    juce::SmoothedValue<float> smoothedCrossModulationDepth;
+
+    //parameters
+    std::atomic<float>* attackParam[2];
+    std::atomic<float>* decayParam[2];
+    std::atomic<float>* sustainParam[2];
+    std::atomic<float>* releaseParam[2];
+
+    // Osc and Unison
+    std::atomic<float>* OscWaveshapeParam[2];
+    std::atomic<float>* Level[2];
+    std::atomic<float>* UnisonParam[2];
+    std::atomic<float>* DetuneParam[2];
+    std::atomic<float>* crossModulationParam;
+    std::atomic<float>* crossModulationDepthParam;
+
+    // Filter Parameters
+    std::atomic<float>* filterOn;
+    std::atomic<float>* filterType;
+    std::atomic<float>* cutoffParam;
+    std::atomic<float>* QParam;
+
+    // LFO Parameters
+    std::atomic<float>* lfoDestinationParam[2];
+    std::atomic<float>* lfoWaveshapeParam[2];
+    std::atomic<float>* lfoFreqParam[2];
+    std::atomic<float>* lfoAmountParam[2];
+    std::atomic<float>* lfoModeParam[2];
+    std::atomic<float>* modulationRateParam;
+};
+
+#endif // SYNTH_PARAMETERS_H
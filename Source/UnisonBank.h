@@ -0,0 +1,181 @@
+/*
+  ==============================================================================
+
+    UnisonBank.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef UNISON_BANK_H
+#define UNISON_BANK_H
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <JuceHeader.h>
+#include "Oscillators.h"   // for the waveshapes
+#include "Wavetable.h"     // for the band-limited waveshapes
+
+/// Structure-of-arrays bank holding every detuned unison voice of one oscillator.
+/// Instead of one OscSwitch (and one std::visit) per unison voice, all phases live in
+/// aligned arrays and are advanced together with juce::dsp::SIMDRegister, a whole block at a time.
+/// The sine is evaluated across the voices too: the phases of a chunk of samples are stored side by side
+/// and run through it in one flat loop the compiler vectorises. The cheaper shapes are applied per voice.
+/// The phase update and the waveshapes (Oscillators.h) match Phasor::process() sample for sample.
+class UnisonBank
+{
+public:
+    using Register = juce::dsp::SIMDRegister<float>;
+
+    static constexpr int maxVoices = 8;                                             // "8" is the largest choice of OscXUnison
+    static constexpr int numRegisters = maxVoices / (int) Register::SIMDNumElements;
+    static constexpr int chunkSize = 64;                                            // samples of phases held at once
+
+    /// prepare the bank for a new note
+    /// @param float, sample rate
+    /// @param int, waveshape id (0 - sine, 1 - triangle, 2 - saw, 3 - square, 4-7 - the same from wavetables)
+    /// @param float, fundamental frequency of the note
+    /// @param float, detune amount in percent (0-100%), 100% spreads the voices 10 Hz apart
+    /// @param int, number of unison voices on top of the main oscillator
+    void startNote(float _sampleRate, int _waveshape, float _frequency, float _detune, int _numVoices)
+    {
+        jassert(_sampleRate > 0.0f);
+        waveshape = _waveshape;
+        numVoices = juce::jlimit(0, maxVoices, _numVoices);
+        topFrequency = 0.0f;
+
+        for (int i = 0; i < maxVoices; i++)
+        {
+            // unison voice i+1 sits (i+1) detune steps above the fundamental; frequencies are
+            // truncated to whole Hz exactly like OscSwitch::startNote does
+            const int frequency = (int) (_frequency + 0.1 * _detune * (i + 1));
+
+            phase[i] = 0.0f;
+            phaseDelta[i] = i < numVoices ? (float) frequency / _sampleRate : 0.0f;
+
+            if (i < numVoices)
+                topFrequency = (float) frequency;
+        }
+    }
+
+    /// render the sum of all unison voices
+    /// @param float*, destination, overwritten with numSamples samples
+    /// @param int, number of samples to render
+    /// @param const float*, frequency ratio of every sample (pitch wheel), nullptr for none
+    void process(float* _dest, int _numSamples, const float* _frequencyRatio = nullptr)
+    {
+        if (WavetableSet::isWavetableWaveshape(waveshape) && wavetables != nullptr)
+        {
+            // every voice reads the table band-limited for the highest detuned voice at the highest ratio of the block
+            const float maxRatio = _frequencyRatio != nullptr ? juce::FloatVectorOperations::findMaximum(_frequencyRatio, _numSamples) : 1.0f;
+            processBlock(_dest, _numSamples, _frequencyRatio, WavetableShape { wavetables->getTable(waveshape - WavetableSet::firstWaveshapeId, topFrequency * maxRatio) });
+            return;
+        }
+
+        switch (waveshape % 4)
+        {
+        case 1:  processBlock(_dest, _numSamples, _frequencyRatio, TriShape()); break;
+        case 2:  processBlock(_dest, _numSamples, _frequencyRatio, SawShape()); break;
+        case 3:  processBlock(_dest, _numSamples, _frequencyRatio, SqrShape()); break;
+        default: processBlock(_dest, _numSamples, _frequencyRatio, SinShape()); break;
+        }
+    }
+
+    /// use the band-limited tables shared by all voices
+    /// @param WavetableSet*, tables owned by the processor
+    void setWavetables(const WavetableSet* _wavetables)
+    {
+        wavetables = _wavetables;
+    }
+
+    int getNumVoices() const
+    {
+        return numVoices;
+    }
+
+private:
+    template <typename Shape>
+    void processBlock(float* _dest, int _numSamples, const float* _frequencyRatio, const Shape& shape)
+    {
+        if (numVoices == 0)
+        {
+            juce::FloatVectorOperations::clear(_dest, _numSamples);
+            return;
+        }
+
+        // the increments are scaled by the ratio of every sample, a ratio of 1 leaves them unchanged
+        auto ratioAt = [_frequencyRatio](int i) { return _frequencyRatio != nullptr ? _frequencyRatio[i] : 1.0f; };
+
+        // the other shapes are a few instructions, cheaper applied to the phases where they are
+        if constexpr (! std::is_same_v<Shape, SinShape>)
+        {
+            for (int i = 0; i < _numSamples; i++)
+            {
+                advancePhases(ratioAt(i));
+                _dest[i] = sumVoices(phase, [&shape](float p) { return shape.output(p); });
+            }
+
+            return;
+        }
+
+        // the sine costs far more than storing the phases: a chunk of them, every voice of a sample side
+        // by side, goes through it in one flat loop the compiler vectorises across the voices and samples
+        alignas(64) float values[chunkSize * maxVoices];
+
+        for (int start = 0; start < _numSamples; start += chunkSize)
+        {
+            const int numSamples = juce::jmin(chunkSize, _numSamples - start);
+
+            for (int i = 0; i < numSamples; i++)
+            {
+                advancePhases(ratioAt(start + i));
+                std::copy(phase, phase + maxVoices, values + i * maxVoices);
+            }
+
+            for (int j = 0; j < numSamples * maxVoices; j++)
+                values[j] = shape.output(values[j]);
+
+            for (int i = 0; i < numSamples; i++)
+                _dest[start + i] = sumVoices(values + i * maxVoices, [](float value) { return value; });
+        }
+    }
+
+    /// advance every lane at once: phase += delta * ratio, wrap above 1
+    /// @param float, frequency ratio of the sample
+    void advancePhases(float _ratio)
+    {
+        const auto one = Register::expand(1.0f);
+        const auto ratio = Register::expand(_ratio);
+
+        for (int r = 0; r < numRegisters; r++)
+        {
+            auto p = Register::fromRawArray(phase + r * Register::SIMDNumElements)
+                   + Register::fromRawArray(phaseDelta + r * Register::SIMDNumElements) * ratio;
+            p = p - (one & Register::greaterThan(p, one));
+            p.copyToRawArray(phase + r * Register::SIMDNumElements);
+        }
+    }
+
+    /// accumulate in voice order so the sum is the same as adding the voices one by one
+    template <typename Function>
+    float sumVoices(const float* _values, Function _output) const
+    {
+        float sum = 0.0f;
+        for (int v = 0; v < numVoices; v++)
+            sum += _output(_values[v]);
+
+        return sum;
+    }
+
+    // the register loads and stores are aligned to the register width, 64 covers every SIMD register JUCE has
+    alignas(64) float phase[maxVoices] = {};
+    alignas(64) float phaseDelta[maxVoices] = {};
+    int numVoices = 0;
+    int waveshape = 0;
+    float topFrequency = 0.0f;                      // frequency of the highest voice, picks the wavetable mip level
+    const WavetableSet* wavetables = nullptr;
+};
+
+#endif // UNISON_BANK_H
@@ -0,0 +1,668 @@
+/*
+  ==============================================================================
+
+    VoiceBank.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef VOICE_BANK_H
+#define VOICE_BANK_H
+
+#include <limits>
+#include <vector>
+#include <JuceHeader.h>
+#include "DspProfiler.h"
+#include "StateVariableFilter.h"
+#include "SynthParameters.h"
+#include "VoiceScratchArena.h"
+
+/// The part of a voice's chunk rendered by the voice itself: the samples of both oscillators, written into
+/// the interleaved buffers of its lane group, and the filter coefficients of the modulation updates in the chunk.
+class VoiceLane
+{
+public:
+    /// position of the chunk in the processed block (per-sample parameters)
+    int getBlockPosition() const
+    {
+        return blockPosition;
+    }
+
+    /// samples to render, the chunk ends early where both envelopes end
+    int getNumSamples() const
+    {
+        return numSamples;
+    }
+
+    /// @param int, sample of the chunk
+    /// @param float, Osc1 plus its unison voices, normalised
+    /// @param float, Osc2 plus its unison voices, normalised
+    void setOscillators(int _index, float _osc1, float _osc2)
+    {
+        osc1[_index * stride] = _osc1;
+        osc2[_index * stride] = _osc2;
+    }
+
+    /// filter the lane with new coefficients from a sample of the chunk on, calls must come in sample order
+    /// @param int, sample of the chunk
+    /// @param juce::IIRCoefficients, coefficients of the voice's filter
+    void setFilterCoefficients(int _index, const juce::IIRCoefficients& _coefficients)
+    {
+        queue(_index, _coefficients.coefficients, false);
+    }
+
+    /// @param int, sample of the chunk
+    /// @param StateVariableCoefficients, coefficients of the voice's filter, a state-variable type
+    void setFilterCoefficients(int _index, const StateVariableCoefficients& _coefficients)
+    {
+        queue(_index, _coefficients.coefficients, true);
+    }
+
+private:
+    friend class VoiceLaneGroup;
+
+    void queue(int _index, const float* _coefficients, bool _stateVariable)
+    {
+        jassert(*numQueued < queueSize && (*numQueued == 0 || queuedAt[*numQueued - 1] <= _index));
+
+        queuedAt[*numQueued] = _index;
+        queuedStateVariable[*numQueued] = _stateVariable;
+        for (int k = 0; k < 5; k++)
+            queued[*numQueued][k] = _coefficients[k];
+
+        (*numQueued)++;
+    }
+
+    float* osc1 = nullptr;
+    float* osc2 = nullptr;
+    int stride = 1;                                  // floats between two samples of the lane
+    int blockPosition = 0;
+    int numSamples = 0;
+
+    int* queuedAt = nullptr;                         // sample of every queued coefficient set
+    float (*queued)[5] = nullptr;
+    bool* queuedStateVariable = nullptr;
+    int* numQueued = nullptr;
+    int queueSize = 0;
+};
+
+/// Voice rendered in a lane of a VoiceLaneGroup. The group runs the envelopes, the mix and the filter of all
+/// its voices together, the voice renders its oscillators and the modulation that drives them.
+class BankVoice
+{
+public:
+    virtual ~BankVoice() = default;
+
+    /// true while the voice holds a note, only these lanes are rendered
+    virtual bool isLaneActive() const = 0;
+
+    /// render the oscillators of a chunk into the lane and queue the filter coefficients of its modulation updates
+    /// @param VoiceLane&, the voice's lane for the chunk
+    virtual void renderChunk(VoiceLane& _lane) = 0;
+
+    /// both envelopes have ended, called after the chunk they end in
+    virtual void laneEnded() = 0;
+
+    /// stage timings of the voice, collected by the engine after every block
+    StageTimer stageTimer;
+};
+
+/// The envelopes, the voice mix and the filter of laneWidth voices (4 with SSE/NEON, 8 with AVX),
+/// in structure-of-arrays form: lane l of every array belongs to voice l of the group, and the
+/// per-sample state of all lanes is advanced with one juce::dsp::SIMDRegister operation.
+/// Both stages are recursions along the samples, which a single voice cannot vectorise;
+/// across voices they cost one pass per group, however many of its lanes are playing.
+///
+/// A chunk is rendered in three passes: the envelopes of all lanes, then the oscillators of every
+/// playing voice (BankVoice::renderChunk), then the mix and the filter of all lanes, written to the
+/// voices' scratch blocks. The envelopes follow juce::ADSR (its curve and its running sum) and the
+/// filter juce::IIRFilter, sample for sample, so a voice sounds exactly as when it rendered them itself.
+/// The state-variable filter types run StateVariableFilter's recursion on the same two state values instead.
+class VoiceLaneGroup : public MonoVoice
+{
+public:
+    using Register = juce::dsp::SIMDRegister<float>;
+
+    static constexpr int laneWidth = (int) Register::SIMDNumElements;
+    static constexpr int chunkSize = 64;             // samples per pass
+
+    VoiceLaneGroup()
+    {
+        for (int e = 0; e < 2; e++)
+            for (int l = 0; l < laneWidth; l++)
+                setState(e, l, idle);
+    }
+
+    /// @param int, lane
+    /// @param BankVoice*, voice of the lane, nullptr for none
+    void setVoice(int _lane, BankVoice* _voice)
+    {
+        voices[_lane] = _voice;
+    }
+
+    /// @param SynthParameters*, snapshot owned by the processor, shared by all voices
+    void setParameters(const SynthParameters* _params)
+    {
+        params = _params;
+    }
+
+    /// @param int, floats between the scratch blocks of two consecutive voices (VoiceScratchArena::getStride())
+    void setBlockStride(int _stride)
+    {
+        blockStride = _stride;
+    }
+
+    /// start the envelopes of a lane and reset its filter (startNote), setFilterCoefficients() then sets the note's coefficients
+    /// @param int, lane
+    /// @param double, sample rate
+    /// @param juce::ADSR::Parameters, Osc1's envelope
+    /// @param juce::ADSR::Parameters, Osc2's envelope
+    void startNote(int _lane, double _sampleRate, const juce::ADSR::Parameters& _envelope1, const juce::ADSR::Parameters& _envelope2)
+    {
+        const juce::ADSR::Parameters* envelopes[] = { &_envelope1, &_envelope2 };
+
+        for (int e = 0; e < 2; e++)
+        {
+            // as juce::ADSR::setSampleRate(), setParameters() and noteOn(), a stolen voice keeps its level
+            sampleRate[_lane] = _sampleRate;
+            recalculateRates(e, _lane);
+            envParameters[e][_lane] = *envelopes[e];
+            recalculateRates(e, _lane);
+            noteOn(e, _lane);
+        }
+
+        filterV1[_lane] = 0.0f;
+        filterV2[_lane] = 0.0f;
+    }
+
+    /// set the filter coefficients of a lane outside of a chunk
+    /// @param int, lane
+    /// @param juce::IIRCoefficients, biquad coefficients
+    void setFilterCoefficients(int _lane, const juce::IIRCoefficients& _coefficients)
+    {
+        setFilterCoefficients(_lane, _coefficients.coefficients, false);
+    }
+
+    /// @param int, lane
+    /// @param StateVariableCoefficients, coefficients of a state-variable type
+    void setFilterCoefficients(int _lane, const StateVariableCoefficients& _coefficients)
+    {
+        setFilterCoefficients(_lane, _coefficients.coefficients, true);
+    }
+
+    /// release the envelopes of a lane (stopNote)
+    /// @param int, lane
+    void stopNote(int _lane)
+    {
+        for (int e = 0; e < 2; e++)
+        {
+            if (envState[e][_lane] == idle)
+                continue;
+
+            if (envParameters[e][_lane].release > 0.0f)
+            {
+                // the release keeps its length whatever level it starts from
+                releaseRate[e][_lane] = (float) (envValue[e][_lane] / (envParameters[e][_lane].release * sampleRate[_lane]));
+                setState(e, _lane, release);
+            }
+            else
+            {
+                resetEnvelope(e, _lane);
+            }
+        }
+    }
+
+    /// render the playing voices of the group, lane l into the block l strides after _dest
+    /// @param float*, scratch block of the group's first voice at the first sample
+    /// @param int, position of the first sample in the processed block
+    /// @param int, number of samples
+    void renderMono(float* _dest, int _startSample, int _numSamples) override
+    {
+        bool playing[laneWidth];
+        bool anyPlaying = false;
+        for (int l = 0; l < laneWidth; l++)
+        {
+            playing[l] = voices[l] != nullptr && voices[l]->isLaneActive();
+            anyPlaying = anyPlaying || playing[l];
+        }
+
+        stageTimer.start();
+
+        for (int chunkStart = 0; anyPlaying && chunkStart < _numSamples; chunkStart += chunkSize)
+        {
+            const int length = juce::jmin(chunkSize, _numSamples - chunkStart);
+            processEnvelopes(length);
+            stageTimer.lap(DspStage::envelope);
+
+            // the voices time their own stages
+            int groupLength = 0;
+            for (int l = 0; l < laneWidth; l++)
+            {
+                numQueued[l] = 0;
+                laneLength[l] = juce::jmax(envLength[0][l], envLength[1][l]);
+
+                if (playing[l] && laneLength[l] > 0)
+                {
+                    VoiceLane lane;
+                    lane.osc1 = oscillators[0] + l;
+                    lane.osc2 = oscillators[1] + l;
+                    lane.stride = laneWidth;
+                    lane.blockPosition = _startSample + chunkStart;
+                    lane.numSamples = laneLength[l];
+                    lane.queuedAt = queuedAt[l];
+                    lane.queued = queuedCoefficients[l];
+                    lane.queuedStateVariable = queuedStateVariable[l];
+                    lane.numQueued = &numQueued[l];
+                    lane.queueSize = chunkSize;
+
+                    voices[l]->renderChunk(lane);
+                    groupLength = juce::jmax(groupLength, laneLength[l]);
+                }
+            }
+            stageTimer.start();
+
+            processMix(groupLength, _startSample + chunkStart);
+
+            // mono, the engine adds it to every channel
+            anyPlaying = false;
+            for (int l = 0; l < laneWidth; l++)
+            {
+                if (!playing[l])
+                    continue;
+
+                float* dest = _dest + (size_t) l * (size_t) blockStride + chunkStart;
+                for (int i = 0; i < laneLength[l]; i++)
+                    dest[i] = (float) (output[i * laneWidth + l] * 0.1);
+
+                // the rest of the block is silent once both envelopes have ended
+                if (envState[0][l] == idle && envState[1][l] == idle)
+                {
+                    juce::FloatVectorOperations::clear(dest + laneLength[l], _numSamples - chunkStart - laneLength[l]);
+                    playing[l] = false;
+                    voices[l]->laneEnded();
+                }
+
+                anyPlaying = anyPlaying || playing[l];
+            }
+            stageTimer.lap(params->filterOn ? DspStage::filter : DspStage::envelope);
+        }
+    }
+
+    /// true if the voice of any lane holds a note
+    bool isActive() const
+    {
+        for (auto* voice : voices)
+            if (voice != nullptr && voice->isLaneActive())
+                return true;
+
+        return false;
+    }
+
+private:
+    enum State
+    {
+        idle,
+        attack,
+        decay,
+        sustain,
+        release
+    };
+
+    /// render both envelopes of every lane for a chunk into envelopes[], and the number of samples
+    /// each was active for into envLength[], including the sample a release ends on
+    void processEnvelopes(int _numSamples)
+    {
+        const auto zero = Register::expand(0.0f);
+
+        for (int e = 0; e < 2; e++)
+        {
+            for (int l = 0; l < laneWidth; l++)
+            {
+                envLength[e][l] = envState[e][l] == idle ? 0 : _numSamples;
+
+                if (envState[e][l] == sustain)
+                    envValue[e][l] = envParameters[e][l].sustain;
+            }
+
+            float* out = envelopes[e];
+            auto value = Register::fromRawArray(envValue[e]);
+            auto increment = Register::fromRawArray(envIncrement[e]);
+            auto target = Register::fromRawArray(envTarget[e]);
+            auto direction = Register::fromRawArray(envDirection[e]);
+
+            for (int i = 0; i < _numSamples; i++)
+            {
+                value = value + increment;
+                value.copyToRawArray(out + i * laneWidth);
+
+                // a segment ends once the running value reaches its target from its side,
+                // the lanes of that sample then take their next state one by one
+                if (Register::greaterThanOrEqual((value - target) * direction, zero).sum() != 0)
+                {
+                    value.copyToRawArray(envValue[e]);
+
+                    for (int l = 0; l < laneWidth; l++)
+                        if ((envValue[e][l] - envTarget[e][l]) * envDirection[e][l] >= 0.0f)
+                            endSegment(e, l, i, _numSamples);
+
+                    value = Register::fromRawArray(envValue[e]);
+                    increment = Register::fromRawArray(envIncrement[e]);
+                    target = Register::fromRawArray(envTarget[e]);
+                    direction = Register::fromRawArray(envDirection[e]);
+                }
+            }
+
+            value.copyToRawArray(envValue[e]);
+        }
+    }
+
+    /// a segment of an envelope reached its end value on a sample, which is set to that value (juce::ADSR::getNextSample())
+    void endSegment(int _envelope, int _lane, int _index, int _numSamples)
+    {
+        const float endValue = envTarget[_envelope][_lane];
+        envelopes[_envelope][_index * laneWidth + _lane] = endValue;
+        envValue[_envelope][_lane] = endValue;
+
+        goToNextState(_envelope, _lane);
+
+        if (envState[_envelope][_lane] == idle)
+            envLength[_envelope][_lane] = _index + 1;
+
+        // the rest of the chunk holds the sustain level, the next chunk sets it otherwise
+        if (envState[_envelope][_lane] == sustain && _index + 1 < _numSamples)
+            envValue[_envelope][_lane] = envParameters[_envelope][_lane].sustain;
+    }
+
+    /// mix both oscillators of every lane with their envelopes and levels, filter them, into output[]
+    /// @param int, samples, the longest lane of the chunk
+    /// @param int, position of the chunk in the processed block (levels)
+    void processMix(int _numSamples, int _blockPosition)
+    {
+        const float* level1 = params->level[0] + _blockPosition;
+        const float* level2 = params->level[1] + _blockPosition;
+
+        auto mix = [&](int i)
+        {
+            const auto osc1 = Register::fromRawArray(oscillators[0] + i * laneWidth);
+            const auto osc2 = Register::fromRawArray(oscillators[1] + i * laneWidth);
+            const auto env1 = Register::fromRawArray(envelopes[0] + i * laneWidth);
+            const auto env2 = Register::fromRawArray(envelopes[1] + i * laneWidth);
+
+            return env1 * Register::expand(level1[i]) * osc1 + env2 * Register::expand(level2[i]) * osc2;
+        };
+
+        if (!params->filterOn)
+        {
+            for (int i = 0; i < _numSamples; i++)
+                mix(i).copyToRawArray(output + i * laneWidth);
+            return;
+        }
+
+        // the coefficients of a lane change where its voice queued them, the samples between two changes
+        // of any lane run as one loop
+        const auto snapLow = Register::expand(-1.0e-8f);
+        const auto snapHigh = Register::expand(1.0e-8f);
+        const auto two = Register::expand(2.0f);
+        auto v1 = Register::fromRawArray(filterV1);
+        auto v2 = Register::fromRawArray(filterV2);
+        int next[laneWidth] = {};
+
+        for (int i = 0; i < _numSamples;)
+        {
+            int end = _numSamples;
+            int numBiquads = 0, numStateVariable = 0;
+            v1.copyToRawArray(filterV1);
+            v2.copyToRawArray(filterV2);
+
+            for (int l = 0; l < laneWidth; l++)
+            {
+                for (; next[l] < numQueued[l] && queuedAt[l][next[l]] <= i; next[l]++)
+                    setFilterCoefficients(l, queuedCoefficients[l][next[l]], queuedStateVariable[l][next[l]]);
+
+                if (next[l] < numQueued[l])
+                    end = juce::jmin(end, queuedAt[l][next[l]]);
+
+                if (laneLength[l] > 0)
+                    (filterStateVariable[l] != 0.0f ? numStateVariable : numBiquads)++;
+            }
+
+            v1 = Register::fromRawArray(filterV1);
+            v2 = Register::fromRawArray(filterV2);
+            const auto c0 = Register::fromRawArray(filterCoefficients[0]);
+            const auto c1 = Register::fromRawArray(filterCoefficients[1]);
+            const auto c2 = Register::fromRawArray(filterCoefficients[2]);
+            const auto c3 = Register::fromRawArray(filterCoefficients[3]);
+            const auto c4 = Register::fromRawArray(filterCoefficients[4]);
+
+            // juce::IIRFilter::processSingleSampleRaw(), v1 and v2 are its delays
+            auto biquad = [&](const Register& in, Register& s1, Register& s2)
+            {
+                auto out = c0 * in + s1;
+                out = out & (Register::lessThan(out, snapLow) | Register::greaterThan(out, snapHigh));    // JUCE_SNAP_TO_ZERO
+                s1 = c1 * in - c3 * out + s2;
+                s2 = c2 * in - c4 * out;
+                return out;
+            };
+
+            // StateVariableFilter::processSample(), v1 and v2 are its integrator memories
+            const auto a2 = c0 * c1;
+            const auto a3 = c0 * a2;
+            auto stateVariable = [&](const Register& in, Register& s1, Register& s2)
+            {
+                const auto v3 = in - s2;
+                const auto band = c1 * s1 + a2 * v3;
+                const auto low = s2 + a2 * s1 + a3 * v3;
+                s1 = two * band - s1;
+                s2 = two * low - s2;
+                return c2 * in + c3 * band + c4 * low;
+            };
+
+            if (numStateVariable == 0)
+            {
+                for (; i < end; i++)
+                    biquad(mix(i), v1, v2).copyToRawArray(output + i * laneWidth);
+            }
+            else if (numBiquads == 0)
+            {
+                for (; i < end; i++)
+                    stateVariable(mix(i), v1, v2).copyToRawArray(output + i * laneWidth);
+            }
+            else
+            {
+                // filterType changed between the two kinds: until every voice has its next update,
+                // both run and each lane takes the result of its own (a lane changing kind starts from silence)
+                const auto isStateVariable = Register::greaterThan(Register::fromRawArray(filterStateVariable), Register::expand(0.0f));
+
+                for (; i < end; i++)
+                {
+                    const auto in = mix(i);
+                    auto b1 = v1, b2 = v2;
+                    const auto biquadOut = biquad(in, b1, b2);
+                    const auto out = stateVariable(in, v1, v2);
+
+                    v1 = (v1 & isStateVariable) + (b1 & ~isStateVariable);
+                    v2 = (v2 & isStateVariable) + (b2 & ~isStateVariable);
+                    ((out & isStateVariable) + (biquadOut & ~isStateVariable)).copyToRawArray(output + i * laneWidth);
+                }
+            }
+        }
+
+        v1.copyToRawArray(filterV1);
+        v2.copyToRawArray(filterV2);
+    }
+
+    void setFilterCoefficients(int _lane, const float* _coefficients, bool _stateVariable)
+    {
+        for (int k = 0; k < 5; k++)
+            filterCoefficients[k][_lane] = _coefficients[k];
+
+        // the two kinds keep different state, the other kind's would ring out as a click
+        if (filterStateVariable[_lane] != (_stateVariable ? 1.0f : 0.0f))
+        {
+            filterV1[_lane] = 0.0f;
+            filterV2[_lane] = 0.0f;
+        }
+
+        filterStateVariable[_lane] = _stateVariable ? 1.0f : 0.0f;
+    }
+
+    // juce::ADSR's state machine on one lane
+
+    void noteOn(int _envelope, int _lane)
+    {
+        if (attackRate[_envelope][_lane] > 0.0f)
+        {
+            setState(_envelope, _lane, attack);
+        }
+        else if (decayRate[_envelope][_lane] > 0.0f)
+        {
+            envValue[_envelope][_lane] = 1.0f;
+            setState(_envelope, _lane, decay);
+        }
+        else
+        {
+            envValue[_envelope][_lane] = envParameters[_envelope][_lane].sustain;
+            setState(_envelope, _lane, sustain);
+        }
+    }
+
+    void resetEnvelope(int _envelope, int _lane)
+    {
+        envValue[_envelope][_lane] = 0.0f;
+        setState(_envelope, _lane, idle);
+    }
+
+    void recalculateRates(int _envelope, int _lane)
+    {
+        const auto& parameters = envParameters[_envelope][_lane];
+        auto getRate = [this, _lane](float _distance, float _timeInSeconds)
+        {
+            return _timeInSeconds > 0.0f ? (float) (_distance / (_timeInSeconds * sampleRate[_lane])) : -1.0f;
+        };
+
+        attackRate[_envelope][_lane] = getRate(1.0f, parameters.attack);
+        decayRate[_envelope][_lane] = getRate(1.0f - parameters.sustain, parameters.decay);
+        releaseRate[_envelope][_lane] = getRate(parameters.sustain, parameters.release);
+
+        const int state = envState[_envelope][_lane];
+        if ((state == attack && attackRate[_envelope][_lane] <= 0.0f)
+            || (state == decay && (decayRate[_envelope][_lane] <= 0.0f || envValue[_envelope][_lane] <= parameters.sustain))
+            || (state == release && releaseRate[_envelope][_lane] <= 0.0f))
+            goToNextState(_envelope, _lane);
+        else
+            setState(_envelope, _lane, (State) state);   // a ramp follows its new rate
+    }
+
+    void goToNextState(int _envelope, int _lane)
+    {
+        const int state = envState[_envelope][_lane];
+
+        if (state == attack)
+            setState(_envelope, _lane, decayRate[_envelope][_lane] > 0.0f ? decay : sustain);
+        else if (state == decay)
+            setState(_envelope, _lane, sustain);
+        else if (state == release)
+            resetEnvelope(_envelope, _lane);
+    }
+
+    /// enter a state: the increment of its ramp and the value that ends it, approached from above when the
+    /// direction is -1; the states without an end get an unreachable target
+    void setState(int _envelope, int _lane, State _state)
+    {
+        constexpr float never = std::numeric_limits<float>::infinity();
+        const float rates[] = { 0.0f, attackRate[_envelope][_lane], -decayRate[_envelope][_lane], 0.0f, -releaseRate[_envelope][_lane] };
+        const float targets[] = { never, 1.0f, envParameters[_envelope][_lane].sustain, never, 0.0f };
+
+        envState[_envelope][_lane] = _state;
+        envIncrement[_envelope][_lane] = rates[_state];
+        envTarget[_envelope][_lane] = targets[_state];
+        envDirection[_envelope][_lane] = _state == decay || _state == release ? -1.0f : 1.0f;
+    }
+
+    BankVoice* voices[laneWidth] = {};
+    const SynthParameters* params = nullptr;
+    int blockStride = 0;
+
+    // envelopes: the running value and the ramp of the current state, per envelope and lane
+    alignas(64) float envValue[2][laneWidth] = {};
+    alignas(64) float envIncrement[2][laneWidth] = {};
+    alignas(64) float envTarget[2][laneWidth] = {};
+    alignas(64) float envDirection[2][laneWidth] = {};
+    int envState[2][laneWidth] = {};
+    float attackRate[2][laneWidth] = {};
+    float decayRate[2][laneWidth] = {};
+    float releaseRate[2][laneWidth] = {};
+    juce::ADSR::Parameters envParameters[2][laneWidth];
+    double sampleRate[laneWidth] = {};
+
+    // filter: juce::IIRFilter's or StateVariableFilter's state and coefficients, per lane
+    alignas(64) float filterV1[laneWidth] = {};
+    alignas(64) float filterV2[laneWidth] = {};
+    alignas(64) float filterCoefficients[5][laneWidth] = {};
+    alignas(64) float filterStateVariable[laneWidth] = {};   // 1 for the coefficients of a state-variable type
+
+    // one chunk, interleaved: sample i of lane l at [i * laneWidth + l]
+    alignas(64) float envelopes[2][chunkSize * laneWidth] = {};
+    alignas(64) float oscillators[2][chunkSize * laneWidth] = {};
+    alignas(64) float output[chunkSize * laneWidth] = {};
+    int envLength[2][laneWidth] = {};
+    int laneLength[laneWidth] = {};
+
+    // filter coefficients queued by the voices for the chunk
+    int queuedAt[laneWidth][chunkSize] = {};
+    float queuedCoefficients[laneWidth][chunkSize][5] = {};
+    bool queuedStateVariable[laneWidth][chunkSize] = {};
+    int numQueued[laneWidth] = {};
+};
+
+/// The lane groups of the whole voice pool in one allocation: voice i of the pool is lane
+/// i % laneWidth of group i / laneWidth. Voices are given the lowest free index first, so the
+/// playing voices fill the first groups and the cost of a block grows a group at a time.
+class VoiceBank
+{
+public:
+    static constexpr int laneWidth = VoiceLaneGroup::laneWidth;
+
+    /// @param int, number of voices in the pool
+    explicit VoiceBank(int _numVoices)
+        : groups((size_t) ((_numVoices + laneWidth - 1) / laneWidth))
+    {
+    }
+
+    /// @param int, voice index in the pool
+    static int getGroupIndex(int _voiceIndex)
+    {
+        return _voiceIndex / laneWidth;
+    }
+
+    VoiceLaneGroup& getGroup(int _index)
+    {
+        return groups[(size_t) _index];
+    }
+
+    int getNumGroups() const
+    {
+        return (int) groups.size();
+    }
+
+    /// @param SynthParameters*, snapshot owned by the processor, shared by all voices
+    void setParameters(const SynthParameters* _params)
+    {
+        for (auto& group : groups)
+            group.setParameters(_params);
+    }
+
+    /// @param int, floats between the scratch blocks of two consecutive voices (VoiceScratchArena::getStride())
+    void setBlockStride(int _stride)
+    {
+        for (auto& group : groups)
+            group.setBlockStride(_stride);
+    }
+
+private:
+    std::vector<VoiceLaneGroup> groups;
+};
+
+#endif // VOICE_BANK_H
@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    VoiceScratchArena.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef VOICE_SCRATCH_ARENA_H
+#define VOICE_SCRATCH_ARENA_H
+
+#include <algorithm>
+#include <cstdint>
+#include <JuceHeader.h>
+#include "DspProfiler.h"
+
+/// Voice that renders a mono signal into a scratch block instead of adding itself to the output buffer.
+class MonoVoice
+{
+public:
+    virtual ~MonoVoice() = default;
+
+    /// render the voice, every destination sample is overwritten
+    /// @param float*, destination of the first sample
+    /// @param int, position of the first sample in the processed block
+    /// @param int, number of samples
+    virtual void renderMono(float* _dest, int _startSample, int _numSamples) = 0;
+
+    /// stage timings of the voice, collected by the engine after every block
+    StageTimer stageTimer;
+};
+
+/// One block of mono scratch memory for every voice of the pool plus one mix block, in a single allocation.
+/// The arena is allocated and written once in prepareToPlay, so the pages are already mapped when the audio
+/// thread uses them: rendering never allocates and never takes a page fault.
+/// Every block starts on a cache line, so voices rendered on different threads never share a line.
+class VoiceScratchArena
+{
+public:
+    static constexpr int alignment = 64;                                   // bytes, one cache line
+    static constexpr int floatsPerLine = alignment / (int) sizeof(float);
+
+    /// allocate and pre-fault the arena (prepareToPlay)
+    /// @param int, number of voice blocks
+    /// @param int, maximum block size
+    void prepare(int _numVoices, int _maxBlockSize)
+    {
+        numVoices = _numVoices;
+        blockSize = juce::jmax(1, _maxBlockSize);
+        stride = (blockSize + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+
+        const size_t numFloats = (size_t) stride * (size_t) (numVoices + 1);
+        memory.allocate(numFloats + (size_t) floatsPerLine, false);
+
+        auto address = reinterpret_cast<std::uintptr_t>(memory.get());
+        base = reinterpret_cast<float*>((address + alignment - 1) & ~(std::uintptr_t) (alignment - 1));
+
+        // writing every page maps it now rather than on the audio thread
+        std::fill(base, base + numFloats, 0.0f);
+    }
+
+    /// check if a range of samples fits in the blocks
+    bool covers(int _startSample, int _numSamples) const
+    {
+        return base != nullptr && _startSample >= 0 && _startSample + _numSamples <= blockSize;
+    }
+
+    /// scratch block of a voice
+    /// @param int, voice index in the pool
+    float* getVoiceBlock(int _voiceIndex) const
+    {
+        jassert(_voiceIndex >= 0 && _voiceIndex < numVoices);
+        return base + (size_t) _voiceIndex * (size_t) stride;
+    }
+
+    /// block the voices are summed into before they are added to the output channels
+    float* getMixBlock() const
+    {
+        return base + (size_t) numVoices * (size_t) stride;
+    }
+
+    int getNumVoices() const
+    {
+        return numVoices;
+    }
+
+    /// samples in every block
+    int getBlockSize() const
+    {
+        return blockSize;
+    }
+
+    /// floats between the blocks of two consecutive voices
+    int getStride() const
+    {
+        return stride;
+    }
+
+private:
+    juce::HeapBlock<float> memory;
+    float* base = nullptr;
+    int numVoices = 0;
+    int blockSize = 0;
+    int stride = 0;                                                        // floats between two blocks
+};
+
+#endif // VOICE_SCRATCH_ARENA_H
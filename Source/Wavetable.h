@@ -0,0 +1,182 @@
+/*
+  ==============================================================================
+
+    Wavetable.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef WAVETABLE_H
+#define WAVETABLE_H
+
+#include <cmath>
+#include <vector>
+#include <JuceHeader.h>
+#include "Oscillators.h"   // for OscPhase
+
+/// Band-limited wavetables for the sine, triangle, saw and square waveshapes.
+/// Every waveshape has one table per octave (mipmap): the table used for a note only contains the
+/// harmonics that stay below Nyquist, so the wavetable oscillators do not alias like SawOsc/SqrOsc.
+/// The tables are generated once per sample rate (prepareToPlay) and then only read, so one set
+/// is shared by all voices.
+/// Each shape is the Fourier series of the corresponding Phasor waveshape (Oscillators.h),
+/// with the same level, DC offset and phase.
+class WavetableSet
+{
+public:
+    static constexpr int tableSize = 2048;
+    static constexpr int numShapes = 4;              // 0 - sine, 1 - triangle, 2 - saw, 3 - square
+    static constexpr int numLevels = 11;             // octaves
+    static constexpr float lowestTopFrequency = 40.0f; // level 0 is band-limited for notes up to 40 Hz, each level doubles it
+
+    static constexpr int firstWaveshapeId = 4;       // "Sine (WT)" in the OscXWaveshape choices
+
+    /// waveshape ids as used by OscXWaveshape
+    static bool isWavetableWaveshape(int _waveshapeId)
+    {
+        return _waveshapeId >= firstWaveshapeId && _waveshapeId < firstWaveshapeId + numShapes;
+    }
+
+    /// generate the tables, does nothing if they were already generated for this sample rate
+    /// (call it from prepareToPlay, never from the audio thread)
+    /// @param double, sample rate
+    void prepare(double _sampleRate)
+    {
+        if (_sampleRate == sampleRate)
+            return;
+
+        tables.assign((size_t) (numShapes * numLevels * stride), 0.0f);
+
+        // one period of a sine, harmonic k at index j is sine[(k * j) % tableSize]
+        std::vector<double> sine((size_t) tableSize);
+        for (int j = 0; j < tableSize; j++)
+            sine[(size_t) j] = std::sin(juce::MathConstants<double>::twoPi * j / tableSize);
+
+        const double pi = juce::MathConstants<double>::pi;
+        std::vector<double> sum((size_t) tableSize);
+
+        for (int level = 0; level < numLevels; level++)
+        {
+            const double topFrequency = lowestTopFrequency * std::pow(2.0, level);
+            const int numHarmonics = juce::jlimit(1, tableSize / 2 - 1, (int) (_sampleRate * 0.5 / topFrequency));
+
+            for (int shape = 0; shape < numShapes; shape++)
+            {
+                std::fill(sum.begin(), sum.end(), 0.0);
+
+                for (int k = 1; k <= numHarmonics; k++)
+                {
+                    double amplitude = 0.0;
+                    int offset = 0;                  // tableSize / 4 turns the sine into a cosine
+
+                    switch (shape)
+                    {
+                    case 1:  // |p - 0.5| - 0.5 = -0.25 + 2/pi^2 * sum over odd k of cos(2 pi k p) / k^2
+                        amplitude = (k % 2 == 1) ? 2.0 / (pi * pi * k * k) : 0.0;
+                        offset = tableSize / 4;
+                        break;
+                    case 2:  // p / pi = 1 / (2 pi) - sum of sin(2 pi k p) / (pi^2 k)
+                        amplitude = -1.0 / (pi * pi * k);
+                        break;
+                    case 3:  // +-0.5 square = 2 / pi * sum over odd k of sin(2 pi k p) / k
+                        amplitude = (k % 2 == 1) ? 2.0 / (pi * k) : 0.0;
+                        break;
+                    default: // sin(2 pi p)
+                        amplitude = k == 1 ? 1.0 : 0.0;
+                        break;
+                    }
+
+                    if (amplitude == 0.0)
+                        continue;
+
+                    for (int j = 0; j < tableSize; j++)
+                        sum[(size_t) j] += amplitude * sine[(size_t) ((k * j + offset) % tableSize)];
+                }
+
+                const double dc = shape == 1 ? -0.25 : (shape == 2 ? 0.5 / pi : 0.0);
+
+                float* t = table(shape, level);
+                for (int j = 0; j < tableSize; j++)
+                    t[j] = (float) (dc + sum[(size_t) j]);
+
+                // guard points so lookup() can read index + 1 for phase == 1
+                t[tableSize] = t[0];
+                t[tableSize + 1] = t[1];
+            }
+        }
+
+        sampleRate = _sampleRate;
+    }
+
+    double getSampleRate() const
+    {
+        return sampleRate;
+    }
+
+    /// table for a waveshape, band-limited for the highest frequency it will play
+    /// @param int, shape (0 - sine, 1 - triangle, 2 - saw, 3 - square)
+    /// @param float, frequency in Hz
+    const float* getTable(int _shape, float _frequency) const
+    {
+        jassert(sampleRate > 0.0);
+        const float frequency = std::abs(_frequency);
+        const int level = frequency <= lowestTopFrequency ? 0
+                        : juce::jmin(numLevels - 1, (int) std::ceil(std::log2(frequency / lowestTopFrequency)));
+        return table(juce::jlimit(0, numShapes - 1, _shape), level);
+    }
+
+    /// read a table with linear interpolation
+    /// @param const float*, table returned by getTable()
+    /// @param float, phase, wrapped into [0, 1] here since frequency modulation can push it below 0
+    static float lookup(const float* _table, float _phase)
+    {
+        float p = _phase - (float) (int) _phase;
+        if (p < 0.0f)
+            p += 1.0f;
+
+        const float index = p * tableSize;
+        const int i = (int) index;
+        const float frac = index - i;
+        return _table[i] + frac * (_table[i + 1] - _table[i]);
+    }
+
+    /// render a buffer with a frequency and a phase offset per sample, same phase update as OscKernel::processModulated
+    static void processModulated(const float* _table, float* dest, int numSamples, float& phase, float freqBase, const float* freqOffsets, const float* phaseOffsets, float sampleRate)
+    {
+        OscPhase::processModulated(dest, numSamples, phase, freqBase, freqOffsets, phaseOffsets, sampleRate);
+
+        for (int i = 0; i < numSamples; i++)
+            dest[i] = lookup(_table, dest[i]);
+    }
+
+private:
+    static constexpr int stride = tableSize + 2;
+
+    float* table(int _shape, int _level)
+    {
+        return tables.data() + (size_t) ((_shape * numLevels + _level) * stride);
+    }
+
+    const float* table(int _shape, int _level) const
+    {
+        return tables.data() + (size_t) ((_shape * numLevels + _level) * stride);
+    }
+
+    std::vector<float> tables;
+    double sampleRate = 0.0;
+};
+
+/// Waveshape reading one band-limited table, used like SinShape etc. where a shape object is accepted (UnisonBank)
+struct WavetableShape
+{
+    const float* table;
+
+    float output(float p) const
+    {
+        return WavetableSet::lookup(table, p);
+    }
+};
+
+#endif // WAVETABLE_H